@@ -0,0 +1,214 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "affinity.h"
+#include "errors.h"
+#include "debug.h"
+
+#define AFFINITY_SYSFS_CPU          "/sys/devices/system/cpu/cpu%d"     ///< Holds a "nodeN" entry per CPU
+
+static bool affinity_parse_cpu(const char *src, char **endptr, unsigned long *cpu)
+{
+    errno = 0;
+    *cpu = strtoul(src, endptr, 10);
+
+    return (errno == 0 && *endptr != src && src[0] != '-' && *cpu < AFFINITY_MAX_CPUS);
+}
+
+bool affinity_parse(const char *list, affinity_t *affinity)
+{
+    unsigned long first = 0;
+    unsigned long last = 0;
+    const char *pos = list;
+    char *endptr = NULL;
+
+    if (list == NULL || affinity == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    affinity->count = 0;
+
+    while (*pos != '\0')
+    {
+        if (affinity_parse_cpu(pos, &endptr, &first) == false)
+            break;
+
+        last = first;
+        if (*endptr == '-' && affinity_parse_cpu(endptr + 1, &endptr, &last) == false)
+            break;
+
+        if (last < first || affinity->count + (last - first) + 1 > AFFINITY_MAX_CPUS)
+            break;
+
+        for (unsigned long cpu = first; cpu <= last; cpu++)
+            affinity->cpus[affinity->count++] = (uint16_t) cpu;
+
+        pos = endptr;
+        if (*pos == ',')
+            pos++;
+        else if (*pos != '\0')
+            break;
+    }
+
+    if (*pos != '\0' || affinity->count == 0)
+    {
+        DEBUG_ERROR("Invalid CPU list \"%s\"", list);
+        g_errno = ERROR_CONVERSION;
+        affinity->count = 0;
+        return false;
+    }
+
+    return true;
+}
+
+int affinity_cpu(const affinity_t *affinity, size_t index)
+{
+    if (affinity == NULL || affinity->count == 0)
+        return AFFINITY_NONE;
+
+    return affinity->cpus[index % affinity->count];
+}
+
+int affinity_node(int cpu)
+{
+    char path[sizeof(AFFINITY_SYSFS_CPU) + 16] = {0};
+    struct dirent *entry = NULL;
+    DIR *dir = NULL;
+    int node = AFFINITY_NONE;
+
+    if (cpu < 0)
+        return AFFINITY_NONE;
+
+    snprintf(path, sizeof(path), AFFINITY_SYSFS_CPU, cpu);
+    dir = opendir(path);
+    if (dir == NULL)
+        return AFFINITY_NONE;
+
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strncmp(entry->d_name, "node", strlen("node")) == 0 &&
+            sscanf(&entry->d_name[strlen("node")], "%d", &node) == 1)
+            break;
+
+        node = AFFINITY_NONE;
+    }
+
+    closedir(dir);
+
+    return node;
+}
+
+void affinity_group_by_node(affinity_t *affinity)
+{
+    int nodes[AFFINITY_MAX_CPUS];
+    uint16_t cpu = 0;
+    int node = 0;
+    size_t j = 0;
+
+    if (affinity == NULL)
+        return;
+
+    /* each lookup walks a sysfs directory, so it is done once per CPU rather than per comparison */
+    for (size_t i = 0; i < affinity->count; i++)
+        nodes[i] = affinity_node(affinity->cpus[i]);
+
+    /* insertion sort: stable, and the lists are short */
+    for (size_t i = 1; i < affinity->count; i++)
+    {
+        cpu = affinity->cpus[i];
+        node = nodes[i];
+
+        for (j = i; j > 0 && nodes[j - 1] > node; j--)
+        {
+            affinity->cpus[j] = affinity->cpus[j - 1];
+            nodes[j] = nodes[j - 1];
+        }
+
+        affinity->cpus[j] = cpu;
+        nodes[j] = node;
+    }
+}
+
+bool affinity_set_attr(pthread_attr_t *attr, int cpu)
+{
+    cpu_set_t set;
+
+    if (attr == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    if (cpu == AFFINITY_NONE)
+        return true;
+
+    CPU_ZERO(&set);
+    CPU_SET((size_t) cpu, &set);
+
+    if (pthread_attr_setaffinity_np(attr, sizeof(set), &set) != 0)
+    {
+        DEBUG_ERROR("Could not pin a thread to CPU %d", cpu);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    return true;
+}
+
+bool affinity_pin_self(int cpu)
+{
+    cpu_set_t set;
+
+    if (cpu == AFFINITY_NONE)
+        return true;
+
+    CPU_ZERO(&set);
+    CPU_SET((size_t) cpu, &set);
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+    {
+        DEBUG_ERROR("Could not pin the thread to CPU %d", cpu);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    return true;
+}
+
+bool affinity_prefer_node(int node)
+{
+    unsigned long mask = 0;
+
+    if (node == AFFINITY_NONE)
+        return true;
+
+    if (node < 0 || node >= AFFINITY_MAX_NODES)
+    {
+        DEBUG_ERROR("NUMA node %d is out of range", node);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    /* the raw system call, so that no libnuma is needed at build or run time */
+    mask = 1UL << node;
+    if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, sizeof(mask) * 8 + 1) != 0)
+    {
+        DEBUG_ERROR("Could not prefer NUMA node %d", node);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef AFFINITY_H__
+#define AFFINITY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#define AFFINITY_MAX_CPUS           (size_t)UINT16_C(1024)  ///< Most CPUs a list can hold (CPU_SETSIZE)
+#define AFFINITY_MAX_NODES          (int)(64)               ///< NUMA nodes that can be preferred
+#define AFFINITY_NONE               (-1)                    ///< No CPU / no NUMA node
+
+/**
+ * @brief List of CPUs threads are pinned to, handed out round robin
+ */
+typedef struct affinity_s {
+    size_t count;                           ///< Number of entries in @p cpus; 0 leaves threads unpinned
+    uint16_t cpus[AFFINITY_MAX_CPUS];       ///< The CPUs, in the order they are handed out
+} affinity_t;
+
+/**
+ * @brief Parse a CPU list such as "0-3,8,10-11"
+ *
+ * @param[in] list The CPU list
+ * @param[out] affinity Where the CPUs are stored
+ *
+ * @retval True if success; false if the list is not valid
+ */
+bool affinity_parse(const char *list, affinity_t *affinity);
+
+/**
+ * @brief Get the CPU of the @p index-th thread of a list
+ *
+ * @param[in] affinity The CPU list
+ * @param[in] index The thread index
+ *
+ * @retval Returns the CPU; AFFINITY_NONE if the list is empty
+ */
+int affinity_cpu(const affinity_t *affinity, size_t index);
+
+/**
+ * @brief Get the NUMA node a CPU belongs to, as reported by sysfs
+ *
+ * @param[in] cpu The CPU
+ *
+ * @retval Returns the node; AFFINITY_NONE if it is not known
+ */
+int affinity_node(int cpu);
+
+/**
+ * @brief Reorder a CPU list so that the CPUs of a node are next to each other
+ *
+ * The order inside a node is kept. Consecutive threads, and so consecutive
+ * shards of the input, end up on the same node.
+ *
+ * @param[in,out] affinity The CPU list
+ */
+void affinity_group_by_node(affinity_t *affinity);
+
+/**
+ * @brief Make the threads created with @p attr start pinned to @p cpu
+ *
+ * @param[in,out] attr The thread attributes
+ * @param[in] cpu The CPU; AFFINITY_NONE leaves the attributes untouched
+ *
+ * @retval True if success; false otherwise
+ */
+bool affinity_set_attr(pthread_attr_t *attr, int cpu);
+
+/**
+ * @brief Pin the calling thread to @p cpu
+ *
+ * @param[in] cpu The CPU; AFFINITY_NONE does nothing
+ *
+ * @retval True if success; false otherwise
+ */
+bool affinity_pin_self(int cpu);
+
+/**
+ * @brief Make the memory first touched by the calling thread come from @p node
+ *
+ * Buffers allocated by a thread, or by another one but only written by
+ * this thread, are then placed on its own node. The kernel falls back to
+ * other nodes when @p node runs out of memory.
+ *
+ * @param[in] node The NUMA node; AFFINITY_NONE does nothing
+ *
+ * @retval True if success; false otherwise
+ */
+bool affinity_prefer_node(int node);
+
+#endif /* AFFINITY_H__ */
@@ -0,0 +1,298 @@
+#include <string.h>
+
+#include "auriga.h"
+#include "message.h"
+#include "format.h"
+#include "utils.h"
+#include "trace.h"
+#include "debug.h"
+
+static error_e auriga_format(const message_t *original, const message_t *modified,
+                             char *dst, size_t dst_size, size_t *written)
+{
+    size_t original_size = 0;
+    size_t modified_size = 0;
+
+    if (format_original(original, dst, dst_size, &original_size) == false)
+        return g_errno;
+
+    if (format_modified(modified, &dst[original_size], dst_size - original_size, &modified_size) == false)
+        return g_errno;
+
+    *written = original_size + modified_size;
+
+    return ERROR_NO_ERROR;
+}
+
+error_e auriga_process_message(const char *src, size_t src_size, uint32_t flags,
+                               char *dst, size_t dst_size, size_t *written)
+{
+    message_t original;
+    message_t modified;
+
+    g_errno = ERROR_NO_ERROR;
+
+    if (src == NULL || dst == NULL || written == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        return ERROR_NULL_PARAMETER;
+    }
+
+    *written = 0;
+    memset(&original, 0, sizeof(original));
+    memset(&modified, 0, sizeof(modified));
+
+    if (message_parse(src, src_size, (flags & AURIGA_FLAG_CORRECT_CRC) != 0, &original, NULL) == false)
+        return g_errno;
+
+    if (message_update(&original, &modified) == false)
+        return g_errno;
+
+    return auriga_format(&original, &modified, dst, dst_size, written);
+}
+
+size_t auriga_process_batch(const auriga_span_t *inputs, size_t count, uint32_t flags,
+                            cache_t *cache,
+                            char *dst, size_t dst_size,
+                            auriga_result_t *results)
+{
+    message_t originals[MESSAGE_BATCH_MAX_SIZE];
+    message_t modified[MESSAGE_BATCH_MAX_SIZE];
+    const char *srcs[MESSAGE_BATCH_MAX_SIZE] = {0};
+    size_t sizes[MESSAGE_BATCH_MAX_SIZE] = {0};
+    error_e errors[MESSAGE_BATCH_MAX_SIZE] = {0};
+    const char *cached[MESSAGE_BATCH_MAX_SIZE] = {0};
+    size_t cached_sizes[MESSAGE_BATCH_MAX_SIZE] = {0};
+    size_t chunk = 0;
+    size_t missed = 0;
+    size_t pos = 0;
+    size_t i = 0;
+    uint64_t begin = 0;
+
+    if (inputs == NULL || dst == NULL || results == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        return 0;
+    }
+
+    /*
+     * Records are taken MESSAGE_BATCH_MAX_SIZE at a time so that the CRCs
+     * of the ones not found in the cache are verified and recomputed together.
+     */
+    for (size_t first = 0; first < count; first += chunk)
+    {
+        chunk = MIN(count - first, MESSAGE_BATCH_MAX_SIZE);
+        missed = 0;
+
+        for (size_t j = 0; j < chunk; j++)
+        {
+            i = first + j;
+            cached[j] = NULL;
+
+            if (cache != NULL &&
+                cache_lookup(cache, inputs[i].data, inputs[i].size, &cached[j], &cached_sizes[j]) == true)
+                continue;
+
+            if (g_trace_ring != NULL)
+                g_trace_ring->lanes[missed] = TRACE_RECORD(i);
+
+            srcs[missed] = inputs[i].data;
+            sizes[missed] = inputs[i].size;
+            memset(&originals[missed], 0, sizeof(originals[missed]));
+            memset(&modified[missed], 0, sizeof(modified[missed]));
+            missed++;
+        }
+
+        message_parse_batch(srcs, sizes, missed, (flags & AURIGA_FLAG_CORRECT_CRC) != 0, originals, errors);
+        message_update_batch(originals, modified, missed, errors);
+
+        missed = 0;
+        for (size_t j = 0; j < chunk; j++)
+        {
+            i = first + j;
+            results[i].offset = pos;
+            results[i].size = 0;
+            results[i].corrected = false;
+            begin = TRACE_BEGIN();
+
+            if (cached[j] != NULL)
+            {
+                if (cached_sizes[j] > dst_size - pos)
+                {
+                    results[i].error = ERROR_BUFFER_SIZE;
+                    continue;
+                }
+
+                memcpy(&dst[pos], cached[j], cached_sizes[j]);
+                results[i].error = ERROR_NO_ERROR;
+                results[i].size = cached_sizes[j];
+                pos += cached_sizes[j];
+                TRACE_END(TRACE_STAGE_FORMAT, begin, TRACE_RECORD(i), 1);
+                continue;
+            }
+
+            results[i].error = errors[missed];
+            if (results[i].error == ERROR_NO_ERROR)
+                results[i].error = auriga_format(&originals[missed], &modified[missed],
+                                                 &dst[pos], MIN(dst_size - pos, AURIGA_OUTPUT_MAX_SIZE),
+                                                 &results[i].size);
+            results[i].corrected = originals[missed].corrected;
+            missed++;
+
+            if (results[i].error == ERROR_NO_ERROR)
+                TRACE_END(TRACE_STAGE_FORMAT, begin, TRACE_RECORD(i), 1);
+
+            pos += results[i].size;
+        }
+
+        if (cache == NULL)
+            continue;
+
+        /*
+         * Only once every hit of the chunk has been copied: an insert may evict
+         * the entry a later hit still points to. A repaired record is kept out,
+         * so that its repeats are repaired (and marked) too.
+         */
+        for (size_t j = 0; j < chunk; j++)
+        {
+            i = first + j;
+            if (cached[j] == NULL && results[i].error == ERROR_NO_ERROR && results[i].corrected == false)
+                cache_insert(cache, inputs[i].data, inputs[i].size, &dst[results[i].offset], results[i].size);
+        }
+    }
+
+    return pos;
+}
+
+error_e auriga_output_size(const char *src, size_t src_size, size_t *size)
+{
+    const size_t keyword_size = sizeof(g_message_leading_keyword) - 1;
+    char length = 0;
+
+    g_errno = ERROR_NO_ERROR;
+
+    if (src == NULL || size == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        return ERROR_NULL_PARAMETER;
+    }
+
+    if (src_size < keyword_size + TYPE_HEX_LENGTH + LENGTH_HEX_LENGTH ||
+        memcmp(src, g_message_leading_keyword, keyword_size) != 0)
+        return ERROR_DATA_NOT_EXPECTED;
+
+    if (utils_hex_to_bin(&src[keyword_size + TYPE_HEX_LENGTH], LENGTH_HEX_LENGTH, &length, sizeof(length)) == false)
+        return ERROR_CONVERSION;
+
+    *size = format_output_size((uint8_t) length);
+    if (*size == 0)
+        return ERROR_LENGTH;
+
+    return ERROR_NO_ERROR;
+}
+
+static size_t auriga_line_end(const char *src, size_t size, size_t pos, bool *terminated)
+{
+    const char *newline = memchr(&src[pos], '\n', size - pos);
+
+    if (newline == NULL)
+    {
+        *terminated = false;
+        return size;
+    }
+
+    *terminated = true;
+
+    return (size_t)(newline - src) + 1;
+}
+
+static bool auriga_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/**
+ * @brief Tell whether the line at @p pos starts with @p keyword; @p known is cleared when the
+ *        buffer ends within what could still be the keyword and more of it is to come
+ */
+static bool auriga_keyword_at(const char *src, size_t size, size_t pos, bool final,
+                              const char *keyword, size_t keyword_size, bool *known)
+{
+    size_t available = size - pos;
+
+    if (available < keyword_size)
+    {
+        *known = (final == true || memcmp(&src[pos], keyword, available) != 0);
+        return false;
+    }
+
+    *known = true;
+
+    return memcmp(&src[pos], keyword, keyword_size) == 0;
+}
+
+size_t auriga_split_records(const char *src, size_t size, bool final,
+                            auriga_span_t *spans, size_t max_spans,
+                            size_t *consumed)
+{
+    const size_t message_keyword_size = sizeof(g_message_leading_keyword) - 1;
+    const size_t mask_keyword_size = sizeof(g_mask_leading_keyword) - 1;
+    bool terminated = false;
+    bool known = false;
+    bool paired = false;
+    size_t count = 0;
+    size_t start = 0;
+    size_t pos = 0;
+
+    if (src == NULL || spans == NULL || consumed == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        return 0;
+    }
+
+    *consumed = 0;
+
+    while (count < max_spans && pos < size)
+    {
+        /* the recognizer skips white space before a record, including lines holding nothing else */
+        if (auriga_blank(src[pos]) == true)
+        {
+            pos++;
+            *consumed = pos;
+            continue;
+        }
+
+        start = pos;
+        pos = auriga_line_end(src, size, pos, &terminated);
+        if (terminated == false && final == false)
+            break;
+
+        /*
+         * Lines are paired by keyword, not by position: a stray line is a record on its own and
+         * fails alone, instead of taking the "mess=" line of the next record as its "mask=" line.
+         */
+        paired = false;
+        if (terminated == true &&
+            auriga_keyword_at(src, size, start, true, g_message_leading_keyword, message_keyword_size, &known) == true)
+        {
+            /* the "mask=" line may still be in the next window */
+            paired = auriga_keyword_at(src, size, pos, final, g_mask_leading_keyword, mask_keyword_size, &known);
+            if (known == false)
+                break;
+        }
+
+        if (paired == true)
+        {
+            pos = auriga_line_end(src, size, pos, &terminated);
+            if (terminated == false && final == false)
+                break;
+        }
+
+        spans[count].data = &src[start];
+        spans[count].size = pos - start;
+        count++;
+        *consumed = pos;
+    }
+
+    return count;
+}
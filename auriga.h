@@ -0,0 +1,123 @@
+#ifndef AURIGA_H__
+#define AURIGA_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "errors.h"
+#include "cache.h"
+
+/**
+ * @brief Upper bound of the output produced for a single record (original and modified blocks)
+ */
+#define AURIGA_OUTPUT_MAX_SIZE      (size_t)UINT16_C(2048)
+
+/**
+ * @brief Repair records whose CRC mismatch is explained by a single flipped bit
+ *
+ * Such a record is processed with the bit flipped back and its result is
+ * marked as corrected, instead of failing with ERROR_CRC. Records whose
+ * CRC matches cost nothing more.
+ */
+#define AURIGA_FLAG_CORRECT_CRC     UINT32_C(0x1)
+
+/**
+ * @brief Caller-owned view over the bytes of one "mess="/"mask=" record
+ */
+typedef struct auriga_span_s {
+    const char *data;       ///< First byte of the record
+    size_t size;            ///< Number of bytes in @p data
+} auriga_span_t;
+
+/**
+ * @brief Per-record outcome of a batch call
+ */
+typedef struct auriga_result_s {
+    error_e error;          ///< ERROR_NO_ERROR if the record was processed
+    size_t offset;          ///< Where the record output starts in the destination buffer
+    size_t size;            ///< How many bytes were written for the record (0 on error)
+    bool corrected;         ///< A single-bit error of the record was repaired, see AURIGA_FLAG_CORRECT_CRC
+} auriga_result_t;
+
+/**
+ * @brief Process one record and write its output block into the given buffer
+ *
+ * No file is touched and no state is shared between calls, so it is safe
+ * to call from several threads at the same time.
+ *
+ * @param[in] src The record bytes ("mess=" line followed by "mask=" line)
+ * @param[in] src_size The size of @p src buffer
+ * @param[in] flags AURIGA_FLAG_* bits, 0 for none
+ * @param[out] dst The destination where the output block will be written
+ * @param[in] dst_size The size of @p dst buffer
+ * @param[out] written How many bytes were written into @p dst
+ *
+ * @retval ERROR_NO_ERROR if success; the error code otherwise
+ */
+error_e auriga_process_message(const char *src, size_t src_size, uint32_t flags,
+                               char *dst, size_t dst_size, size_t *written);
+
+/**
+ * @brief Process several records, writing the output blocks back to back into the given buffer
+ *
+ * A failing record does not stop the batch: its result holds the error
+ * code and nothing is written for it. When a @p cache is given, records
+ * already seen are answered from it instead of being processed again.
+ * If the calling thread records into a trace ring (see trace_switch()),
+ * the stages of each record are traced, @p inputs[0] being record
+ * g_trace_ring->base of the input.
+ *
+ * @param[in] inputs The records to be processed
+ * @param[in] count How many entries there are in @p inputs and @p results
+ * @param[in] flags AURIGA_FLAG_* bits, 0 for none
+ * @param[in,out] cache Cache of output blocks owned by the calling thread (may be NULL)
+ * @param[out] dst The destination where the output blocks will be written
+ * @param[in] dst_size The size of @p dst buffer
+ * @param[out] results The outcome of each record
+ *
+ * @retval Returns how many bytes were written into @p dst
+ */
+size_t auriga_process_batch(const auriga_span_t *inputs, size_t count, uint32_t flags,
+                            cache_t *cache,
+                            char *dst, size_t dst_size,
+                            auriga_result_t *results);
+
+/**
+ * @brief Compute the size of the output block of a record from its header alone
+ *
+ * Only the type and length of the "mess=" line are looked at, so this is
+ * cheap enough to run over a whole input to lay out the output in advance.
+ *
+ * @param[in] src The record bytes
+ * @param[in] src_size The size of @p src buffer
+ * @param[out] size The size of the output block the record will produce
+ *
+ * @retval ERROR_NO_ERROR if success; the error code otherwise
+ */
+error_e auriga_output_size(const char *src, size_t src_size, size_t *size);
+
+/**
+ * @brief Cut a buffer into record spans ("mess=" line followed by "mask=" line)
+ *
+ * White space between records, including lines holding nothing else, is
+ * skipped as record_scan() does. A "mask=" line is only joined to the
+ * "mess=" line right before it; any other line is a span of its own, so a
+ * stray line fails alone instead of shifting the records after it. A
+ * trailing record that is not terminated by a new line is only returned
+ * when @p final is set, so the buffer can be a window over a larger input.
+ *
+ * @param[in] src The buffer to be split
+ * @param[in] size The size of @p src buffer
+ * @param[in] final True if nothing follows @p src
+ * @param[out] spans Where the record spans are stored
+ * @param[in] max_spans How many entries there are in @p spans
+ * @param[out] consumed How many bytes of @p src are covered by the returned spans
+ *
+ * @retval Returns how many spans were stored
+ */
+size_t auriga_split_records(const char *src, size_t size, bool final,
+                            auriga_span_t *spans, size_t max_spans,
+                            size_t *consumed);
+
+#endif /* AURIGA_H__ */
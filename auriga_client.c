@@ -0,0 +1,441 @@
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "auriga.h"
+#include "errors.h"
+#include "debug.h"
+
+#define CLIENT_DEFAULT_INPUT        ("data_in.txt")             ///< Records sent when no input is given
+#define CLIENT_DEFAULT_REQUESTS     (size_t)UINT32_C(100000)    ///< Records sent when no count is given
+#define CLIENT_DEFAULT_DEPTH        (size_t)UINT8_C(1)          ///< Requests in flight when no depth is given
+#define CLIENT_READ_SIZE            (size_t)UINT32_C(65536)     ///< Reply bytes read at once
+#define CLIENT_SPLIT_SIZE           (size_t)UINT16_C(4096)      ///< Records split from the input at once
+#define CLIENT_REPLY_END            ("modified CRC-32: ")       ///< Start of the last line of a reply
+#define CLIENT_REPLY_ERROR          ("error: ")                 ///< Start of the reply to a record that failed
+
+/**
+ * @brief Load generator state: the records to send and the latency of each request
+ */
+typedef struct client_s {
+    const char *socket;         ///< Server socket
+    const char *input;          ///< File holding the records to send
+    size_t requests;            ///< Records to send
+    size_t depth;               ///< Requests kept in flight
+    char *data;                 ///< Mapped input file
+    size_t data_size;           ///< Size of @p data
+    auriga_span_t *spans;       ///< Records of the input, sent in turn
+    size_t count;               ///< Entries in @p spans
+    uint64_t *sent_at;          ///< When each request was written, in nanoseconds
+    uint64_t *latencies;        ///< Round trip of each request, in nanoseconds
+    size_t sent;                ///< Requests written
+    size_t received;            ///< Replies read
+    size_t failures;            ///< Replies that were errors
+    int fd;                     ///< Connected socket
+} client_t;
+
+static uint64_t client_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * UINT64_C(1000000000) + (uint64_t) now.tv_nsec;
+}
+
+static void client_usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s -S SOCKET [options]\n"
+            "  -S, --socket SOCKET   socket the server listens on\n"
+            "  -i, --input FILE      records to send, in turn (default: %s)\n"
+            "  -n, --requests N      records to send (default: %zu)\n"
+            "  -d, --depth N         requests kept in flight (default: %zu)\n"
+            "  -h, --help            show this help\n",
+            program, CLIENT_DEFAULT_INPUT, CLIENT_DEFAULT_REQUESTS, CLIENT_DEFAULT_DEPTH);
+}
+
+static bool client_parse_size(const char *name, const char *value, size_t *dst)
+{
+    unsigned long long parsed = 0;
+    char *endptr = NULL;
+
+    errno = 0;
+    parsed = strtoull(value, &endptr, 10);
+    if (errno != 0 || endptr == value || *endptr != '\0' || value[0] == '-' || parsed == 0)
+    {
+        DEBUG_ERROR("Invalid value \"%s\" for --%s", value, name);
+        g_errno = ERROR_CONVERSION;
+        return false;
+    }
+
+    *dst = (size_t) parsed;
+
+    return true;
+}
+
+static bool client_parse(int argc, char **argv, client_t *client)
+{
+    static const struct option long_options[] = {
+        { "socket",   required_argument, NULL, 'S' },
+        { "input",    required_argument, NULL, 'i' },
+        { "requests", required_argument, NULL, 'n' },
+        { "depth",    required_argument, NULL, 'd' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL,       0,                 NULL, 0   },
+    };
+    int option = 0;
+
+    client->input = CLIENT_DEFAULT_INPUT;
+    client->requests = CLIENT_DEFAULT_REQUESTS;
+    client->depth = CLIENT_DEFAULT_DEPTH;
+
+    while ((option = getopt_long(argc, argv, "S:i:n:d:h", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+            case 'S':
+                client->socket = optarg;
+                break;
+
+            case 'i':
+                client->input = optarg;
+                break;
+
+            case 'n':
+                if (client_parse_size("requests", optarg, &client->requests) == false)
+                    return false;
+                break;
+
+            case 'd':
+                if (client_parse_size("depth", optarg, &client->depth) == false)
+                    return false;
+                break;
+
+            case 'h':
+                client_usage(argv[0]);
+                return false;
+
+            default:
+                client_usage(argv[0]);
+                g_errno = ERROR_DATA_NOT_EXPECTED;
+                return false;
+        }
+    }
+
+    if (optind != argc || client->socket == NULL)
+    {
+        client_usage(argv[0]);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    return true;
+}
+
+static bool client_load(client_t *client)
+{
+    auriga_span_t *spans = NULL;
+    struct stat status;
+    size_t consumed = 0;
+    size_t count = 0;
+    size_t pos = 0;
+    int fd = -1;
+
+    fd = open(client->input, O_RDONLY);
+    if (fd < 0 || fstat(fd, &status) != 0 || status.st_size == 0)
+    {
+        DEBUG_ERROR("Could not read \"%s\"", client->input);
+        g_errno = ERROR_READING_FILE;
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    client->data_size = (size_t) status.st_size;
+    client->data = mmap(NULL, client->data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (client->data == MAP_FAILED)
+    {
+        client->data = NULL;
+        DEBUG_ERROR("Could not map \"%s\"", client->input);
+        g_errno = ERROR_READING_FILE;
+        return false;
+    }
+
+    do
+    {
+        spans = realloc(client->spans, (client->count + CLIENT_SPLIT_SIZE) * sizeof(*spans));
+        if (spans == NULL)
+        {
+            DEBUG_ERROR("Could not allocate the records");
+            g_errno = ERROR_BUFFER_SIZE;
+            return false;
+        }
+        client->spans = spans;
+
+        count = auriga_split_records(&client->data[pos], client->data_size - pos, true,
+                                     &client->spans[client->count], CLIENT_SPLIT_SIZE, &consumed);
+        client->count += count;
+        pos += consumed;
+    } while (count == CLIENT_SPLIT_SIZE);
+
+    if (client->count == 0)
+    {
+        DEBUG_ERROR("No record in \"%s\"", client->input);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    return true;
+}
+
+static bool client_connect(client_t *client)
+{
+    struct sockaddr_un address;
+
+    if (strlen(client->socket) >= sizeof(address.sun_path))
+    {
+        DEBUG_ERROR("Socket path \"%s\" is too long", client->socket);
+        g_errno = ERROR_BUFFER_SIZE;
+        return false;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, client->socket, strlen(client->socket));
+
+    client->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (client->fd < 0 ||
+        connect(client->fd, (const struct sockaddr *) &address, sizeof(address)) != 0 ||
+        fcntl(client->fd, F_SETFL, O_NONBLOCK) != 0)
+    {
+        DEBUG_ERROR("Could not connect to \"%s\"", client->socket);
+        g_errno = ERROR_NOT_OPEN_FILE;
+        return false;
+    }
+
+    return true;
+}
+
+static void client_queue(client_t *client, char *buffer, size_t capacity, size_t *size)
+{
+    const auriga_span_t *span = NULL;
+    uint64_t now = client_now();
+
+    /* the requests are timed from the moment they are queued for the single write */
+    while (client->sent < client->requests && client->sent - client->received < client->depth)
+    {
+        span = &client->spans[client->sent % client->count];
+        if (*size + span->size + 1 > capacity)
+            break;
+
+        memcpy(&buffer[*size], span->data, span->size);
+        *size += span->size;
+        if (span->data[span->size - 1] != '\n')
+            buffer[(*size)++] = '\n';
+
+        client->sent_at[client->sent++] = now;
+    }
+}
+
+static void client_replies(client_t *client, char *buffer, size_t *size)
+{
+    uint64_t now = client_now();
+    size_t start = 0;
+    char *end = NULL;
+
+    while ((end = memchr(&buffer[start], '\n', *size - start)) != NULL)
+    {
+        if (strncmp(&buffer[start], CLIENT_REPLY_ERROR, strlen(CLIENT_REPLY_ERROR)) == 0)
+            client->failures++;
+
+        if (strncmp(&buffer[start], CLIENT_REPLY_END, strlen(CLIENT_REPLY_END)) == 0 ||
+            strncmp(&buffer[start], CLIENT_REPLY_ERROR, strlen(CLIENT_REPLY_ERROR)) == 0)
+        {
+            client->latencies[client->received] = now - client->sent_at[client->received];
+            client->received++;
+        }
+
+        start = (size_t)(end - buffer) + 1;
+    }
+
+    memmove(buffer, &buffer[start], *size - start);
+    *size -= start;
+}
+
+static bool client_run(client_t *client)
+{
+    struct pollfd poller;
+    char *requests = NULL;
+    char *replies = NULL;
+    size_t request_capacity = 0;
+    size_t request_start = 0;
+    size_t request_size = 0;
+    size_t reply_size = 0;
+    size_t largest = 0;
+    ssize_t done = 0;
+    bool success = false;
+
+    for (size_t i = 0; i < client->count; i++)
+        largest = (client->spans[i].size > largest) ? client->spans[i].size : largest;
+
+    request_capacity = (client->depth < client->requests ? client->depth : client->requests) * (largest + 1);
+    requests = malloc(request_capacity);
+    replies = malloc(CLIENT_READ_SIZE);
+    if (requests == NULL || replies == NULL)
+    {
+        DEBUG_ERROR("Could not allocate the client buffers");
+        g_errno = ERROR_BUFFER_SIZE;
+        goto cleanup;
+    }
+
+    while (client->received < client->requests)
+    {
+        if (request_start == request_size)
+        {
+            request_start = 0;
+            request_size = 0;
+            client_queue(client, requests, request_capacity, &request_size);
+        }
+
+        poller.fd = client->fd;
+        poller.events = POLLIN;
+        poller.revents = 0;
+        if (request_start < request_size)
+            poller.events |= POLLOUT;
+
+        if (poll(&poller, 1, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            DEBUG_ERROR("Could not wait for the server");
+            g_errno = ERROR_READING_FILE;
+            goto cleanup;
+        }
+
+        if ((poller.revents & POLLOUT) != 0)
+        {
+            done = send(client->fd, &requests[request_start], request_size - request_start, MSG_NOSIGNAL);
+            if (done < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                DEBUG_ERROR("Could not send to the server");
+                g_errno = ERROR_READING_FILE;
+                goto cleanup;
+            }
+            if (done > 0)
+                request_start += (size_t) done;
+        }
+
+        if ((poller.revents & (POLLIN | POLLHUP | POLLERR)) != 0)
+        {
+            done = recv(client->fd, &replies[reply_size], CLIENT_READ_SIZE - reply_size, 0);
+            if (done == 0 || (done < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            {
+                DEBUG_ERROR("The server closed the connection after %zu replies", client->received);
+                g_errno = ERROR_READING_FILE;
+                goto cleanup;
+            }
+            if (done > 0)
+            {
+                reply_size += (size_t) done;
+                client_replies(client, replies, &reply_size);
+            }
+        }
+    }
+
+    success = true;
+
+cleanup:
+    free(requests);
+    free(replies);
+
+    return success;
+}
+
+static int client_compare(const void *a, const void *b)
+{
+    uint64_t left = *(const uint64_t *) a;
+    uint64_t right = *(const uint64_t *) b;
+
+    return (left > right) - (left < right);
+}
+
+static double client_percentile(const uint64_t *sorted, size_t count, size_t per_mille)
+{
+    /* nearest rank */
+    size_t rank = (count * per_mille + 999) / 1000;
+
+    return (double) sorted[(rank == 0) ? 0 : rank - 1] / 1000.0;
+}
+
+static void client_report(client_t *client, uint64_t elapsed)
+{
+    double seconds = (double) elapsed / 1e9;
+
+    qsort(client->latencies, client->received, sizeof(*client->latencies), client_compare);
+
+    printf("requests: %zu, errors: %zu, depth: %zu\n", client->received, client->failures, client->depth);
+    printf("elapsed: %.3f s, throughput: %.0f requests/s\n", seconds, (double) client->received / seconds);
+    printf("latency (us): p50 %.1f, p99 %.1f, p999 %.1f, max %.1f\n",
+           client_percentile(client->latencies, client->received, 500),
+           client_percentile(client->latencies, client->received, 990),
+           client_percentile(client->latencies, client->received, 999),
+           (double) client->latencies[client->received - 1] / 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+    client_t client;
+    uint64_t start = 0;
+    bool success = false;
+
+    memset(&client, 0, sizeof(client));
+    client.fd = -1;
+
+    if (client_parse(argc, argv, &client) == false)
+        return g_errno;
+
+    if (client_load(&client) == false || client_connect(&client) == false)
+        goto cleanup;
+
+    client.sent_at = calloc(client.requests, sizeof(*client.sent_at));
+    client.latencies = calloc(client.requests, sizeof(*client.latencies));
+    if (client.sent_at == NULL || client.latencies == NULL)
+    {
+        DEBUG_ERROR("Could not allocate the latency samples");
+        g_errno = ERROR_BUFFER_SIZE;
+        goto cleanup;
+    }
+
+    start = client_now();
+    success = client_run(&client);
+    if (success == true)
+        client_report(&client, client_now() - start);
+
+cleanup:
+    if (client.fd >= 0)
+        close(client.fd);
+    if (client.data != NULL)
+        munmap(client.data, client.data_size);
+    free(client.spans);
+    free(client.sent_at);
+    free(client.latencies);
+
+    if (success == false)
+        return g_errno;
+
+    return 0;
+}
@@ -0,0 +1,425 @@
+#define _GNU_SOURCE
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "auriga.h"
+#include "ring.h"
+#include "errors.h"
+#include "debug.h"
+
+#define PRODUCER_DEFAULT_INPUT      ("data_in.txt")             ///< Records pushed when no input is given
+#define PRODUCER_DEFAULT_REQUESTS   (size_t)UINT32_C(100000)    ///< Records pushed when no count is given
+#define PRODUCER_SPLIT_SIZE         (size_t)UINT16_C(4096)      ///< Records split from the input at once
+#define PRODUCER_SLEEP_MS           (int)(100)                  ///< Longest sleep on the response ring, so that a gone processor is noticed
+#define PRODUCER_REPLY_ERROR        ("error: ")                 ///< Start of the line written for a record that failed
+
+/**
+ * @brief Producer state: the records to push and the latency of each request
+ */
+typedef struct producer_s {
+    const char *ring_name;      ///< Shared memory object of the processor
+    const char *input;          ///< File holding the records to push
+    const char *output;         ///< File the responses are written to (NULL discards them)
+    size_t requests;            ///< Records to push
+    char *data;                 ///< Mapped input file
+    size_t data_size;           ///< Size of @p data
+    auriga_span_t *spans;       ///< Records of the input, pushed in turn
+    size_t count;               ///< Entries in @p spans
+    uint64_t *sent_at;          ///< When each request was published, in nanoseconds
+    uint64_t *latencies;        ///< Round trip of each request, in nanoseconds
+    size_t sent;                ///< Requests published
+    size_t received;            ///< Responses read
+    size_t failures;            ///< Responses that were errors
+    size_t corrected;           ///< Responses to records whose single-bit error was repaired
+    ring_t ring;                ///< The attached rings
+    FILE *out;                  ///< Opened @p output
+} producer_t;
+
+static uint64_t producer_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * UINT64_C(1000000000) + (uint64_t) now.tv_nsec;
+}
+
+static void producer_usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s -R NAME [options]\n"
+            "  -R, --ring NAME       shared memory object of \"test_is --ring\"\n"
+            "  -i, --input FILE      records to push, in turn (default: %s)\n"
+            "  -n, --requests N      records to push (default: %zu)\n"
+            "  -o, --output FILE     write the responses, in order, into FILE\n"
+            "  -h, --help            show this help\n",
+            program, PRODUCER_DEFAULT_INPUT, PRODUCER_DEFAULT_REQUESTS);
+}
+
+static bool producer_parse_size(const char *name, const char *value, size_t *dst)
+{
+    unsigned long long parsed = 0;
+    char *endptr = NULL;
+
+    errno = 0;
+    parsed = strtoull(value, &endptr, 10);
+    if (errno != 0 || endptr == value || *endptr != '\0' || value[0] == '-' || parsed == 0)
+    {
+        DEBUG_ERROR("Invalid value \"%s\" for --%s", value, name);
+        g_errno = ERROR_CONVERSION;
+        return false;
+    }
+
+    *dst = (size_t) parsed;
+
+    return true;
+}
+
+static bool producer_parse(int argc, char **argv, producer_t *producer)
+{
+    static const struct option long_options[] = {
+        { "ring",     required_argument, NULL, 'R' },
+        { "input",    required_argument, NULL, 'i' },
+        { "requests", required_argument, NULL, 'n' },
+        { "output",   required_argument, NULL, 'o' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL,       0,                 NULL, 0   },
+    };
+    int option = 0;
+
+    producer->input = PRODUCER_DEFAULT_INPUT;
+    producer->requests = PRODUCER_DEFAULT_REQUESTS;
+
+    while ((option = getopt_long(argc, argv, "R:i:n:o:h", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+            case 'R':
+                producer->ring_name = optarg;
+                break;
+
+            case 'i':
+                producer->input = optarg;
+                break;
+
+            case 'n':
+                if (producer_parse_size("requests", optarg, &producer->requests) == false)
+                    return false;
+                break;
+
+            case 'o':
+                producer->output = optarg;
+                break;
+
+            case 'h':
+                producer_usage(argv[0]);
+                return false;
+
+            default:
+                producer_usage(argv[0]);
+                g_errno = ERROR_DATA_NOT_EXPECTED;
+                return false;
+        }
+    }
+
+    if (optind != argc || producer->ring_name == NULL)
+    {
+        producer_usage(argv[0]);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    return true;
+}
+
+static bool producer_load(producer_t *producer)
+{
+    auriga_span_t *spans = NULL;
+    struct stat status;
+    size_t consumed = 0;
+    size_t count = 0;
+    size_t pos = 0;
+    int fd = -1;
+
+    fd = open(producer->input, O_RDONLY);
+    if (fd < 0 || fstat(fd, &status) != 0 || status.st_size == 0)
+    {
+        DEBUG_ERROR("Could not read \"%s\"", producer->input);
+        g_errno = ERROR_READING_FILE;
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    producer->data_size = (size_t) status.st_size;
+    producer->data = mmap(NULL, producer->data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (producer->data == MAP_FAILED)
+    {
+        producer->data = NULL;
+        DEBUG_ERROR("Could not map \"%s\"", producer->input);
+        g_errno = ERROR_READING_FILE;
+        return false;
+    }
+
+    do
+    {
+        spans = realloc(producer->spans, (producer->count + PRODUCER_SPLIT_SIZE) * sizeof(*spans));
+        if (spans == NULL)
+        {
+            DEBUG_ERROR("Could not allocate the records");
+            g_errno = ERROR_BUFFER_SIZE;
+            return false;
+        }
+        producer->spans = spans;
+
+        count = auriga_split_records(&producer->data[pos], producer->data_size - pos, true,
+                                     &producer->spans[producer->count], PRODUCER_SPLIT_SIZE, &consumed);
+        producer->count += count;
+        pos += consumed;
+    } while (count == PRODUCER_SPLIT_SIZE);
+
+    if (producer->count == 0)
+    {
+        DEBUG_ERROR("No record in \"%s\"", producer->input);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    for (size_t i = 0; i < producer->count; i++)
+    {
+        if (producer->spans[i].size > RING_REQUEST_SIZE)
+        {
+            DEBUG_ERROR("Record %zu of \"%s\" does not fit a request slot", i, producer->input);
+            g_errno = ERROR_BUFFER_SIZE;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static size_t producer_push(producer_t *producer)
+{
+    ring_shared_t *shared = producer->ring.shared;
+    uint64_t head = atomic_load_explicit(&shared->requests.head, memory_order_relaxed);
+    const auriga_span_t *span = NULL;
+    ring_request_t *request = NULL;
+    size_t count = ring_writable(&shared->requests, producer->ring.slots);
+    uint64_t now = 0;
+
+    if (count > producer->requests - producer->sent)
+        count = producer->requests - producer->sent;
+    if (count == 0)
+        return 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        span = &producer->spans[(producer->sent + i) % producer->count];
+        request = &producer->ring.requests[(head + i) & (producer->ring.slots - 1)];
+        request->id = (uint64_t)(producer->sent + i);
+        request->size = (uint32_t) span->size;
+        memcpy(request->data, span->data, span->size);
+    }
+
+    /* the requests are timed from the moment they are published together */
+    now = producer_now();
+    for (size_t i = 0; i < count; i++)
+        producer->sent_at[producer->sent + i] = now;
+
+    ring_publish(&shared->requests, count);
+    producer->sent += count;
+
+    return count;
+}
+
+static bool producer_drain(producer_t *producer, size_t *drained)
+{
+    ring_shared_t *shared = producer->ring.shared;
+    uint64_t tail = atomic_load_explicit(&shared->responses.tail, memory_order_relaxed);
+    const ring_response_t *response = NULL;
+    const char *description = NULL;
+    size_t count = ring_readable(&shared->responses);
+    uint64_t now = producer_now();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        response = &producer->ring.responses[(tail + i) & (producer->ring.slots - 1)];
+        if (response->id != (uint64_t) producer->received || response->size > RING_RESPONSE_SIZE)
+        {
+            DEBUG_ERROR("Response %zu is out of order or malformed", producer->received);
+            g_errno = ERROR_DATA_NOT_EXPECTED;
+            return false;
+        }
+
+        if (response->error != ERROR_NO_ERROR)
+            producer->failures++;
+        if ((response->flags & RING_FLAG_CORRECTED) != 0)
+            producer->corrected++;
+
+        if (producer->out != NULL)
+        {
+            if (response->error == ERROR_NO_ERROR)
+            {
+                fwrite(response->data, 1, response->size, producer->out);
+            }
+            else
+            {
+                description = error_string((error_e) response->error);
+                if (description == NULL)
+                    fprintf(producer->out, "%sUnknown error value: %" PRIu32 "\n", PRODUCER_REPLY_ERROR, response->error);
+                else
+                    fprintf(producer->out, "%s%s\n", PRODUCER_REPLY_ERROR, description);
+            }
+        }
+
+        producer->latencies[producer->received] = now - producer->sent_at[producer->received];
+        producer->received++;
+    }
+
+    if (count != 0)
+        ring_release(&shared->responses, count);
+    *drained = count;
+
+    return true;
+}
+
+static bool producer_run(producer_t *producer)
+{
+    ring_shared_t *shared = producer->ring.shared;
+    uint32_t doorbell = 0;
+    size_t pushed = 0;
+    size_t drained = 0;
+
+    while (producer->received < producer->requests)
+    {
+        pushed = producer_push(producer);
+        if (producer_drain(producer, &drained) == false)
+            return false;
+
+        if (pushed != 0 || drained != 0)
+            continue;
+
+        /* every request is in flight, or the request ring is full: wait for responses */
+        doorbell = ring_doorbell(&shared->responses);
+        if (ring_readable(&shared->responses) != 0)
+            continue;
+
+        if (ring_stopped(&producer->ring) == true)
+        {
+            DEBUG_ERROR("The processor stopped after %zu responses", producer->received);
+            g_errno = ERROR_READING_FILE;
+            return false;
+        }
+
+        ring_wait(&shared->responses, doorbell, PRODUCER_SLEEP_MS);
+    }
+
+    return true;
+}
+
+static int producer_compare(const void *a, const void *b)
+{
+    uint64_t left = *(const uint64_t *) a;
+    uint64_t right = *(const uint64_t *) b;
+
+    return (left > right) - (left < right);
+}
+
+static double producer_percentile(const uint64_t *sorted, size_t count, size_t per_mille)
+{
+    /* nearest rank */
+    size_t rank = (count * per_mille + 999) / 1000;
+
+    return (double) sorted[(rank == 0) ? 0 : rank - 1] / 1000.0;
+}
+
+static void producer_report(producer_t *producer, uint64_t elapsed)
+{
+    double seconds = (double) elapsed / 1e9;
+
+    qsort(producer->latencies, producer->received, sizeof(*producer->latencies), producer_compare);
+
+    printf("requests: %zu, errors: %zu, corrected: %zu, slots: %zu\n",
+           producer->received, producer->failures, producer->corrected, producer->ring.slots);
+    printf("elapsed: %.3f s, throughput: %.0f requests/s\n", seconds, (double) producer->received / seconds);
+    printf("latency (us): p50 %.1f, p99 %.1f, p999 %.1f, max %.1f\n",
+           producer_percentile(producer->latencies, producer->received, 500),
+           producer_percentile(producer->latencies, producer->received, 990),
+           producer_percentile(producer->latencies, producer->received, 999),
+           (double) producer->latencies[producer->received - 1] / 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+    producer_t producer;
+    uint64_t start = 0;
+    bool success = false;
+
+    memset(&producer, 0, sizeof(producer));
+
+    if (producer_parse(argc, argv, &producer) == false)
+        return g_errno;
+
+    if (producer_load(&producer) == false)
+        goto cleanup;
+
+    if (ring_attach(&producer.ring, producer.ring_name) == false)
+    {
+        DEBUG_ERROR("Could not attach to \"%s\": %s", producer.ring_name, error_string(g_errno));
+        goto cleanup;
+    }
+
+    if (producer.output != NULL)
+    {
+        producer.out = fopen(producer.output, "w");
+        if (producer.out == NULL)
+        {
+            DEBUG_ERROR("Creating/opening \"%s\" file", producer.output);
+            g_errno = ERROR_FILE_CREATION;
+            goto cleanup;
+        }
+    }
+
+    producer.sent_at = calloc(producer.requests, sizeof(*producer.sent_at));
+    producer.latencies = calloc(producer.requests, sizeof(*producer.latencies));
+    if (producer.sent_at == NULL || producer.latencies == NULL)
+    {
+        DEBUG_ERROR("Could not allocate the latency samples");
+        g_errno = ERROR_BUFFER_SIZE;
+        goto cleanup;
+    }
+
+    start = producer_now();
+    success = producer_run(&producer);
+    if (success == true)
+        producer_report(&producer, producer_now() - start);
+
+cleanup:
+    ring_detach(&producer.ring);
+    if (producer.out != NULL && fclose(producer.out) != 0)
+    {
+        DEBUG_ERROR("Could not write into file \"%s\"", producer.output);
+        g_errno = ERROR_FILE_CREATION;
+        success = false;
+    }
+    if (producer.data != NULL)
+        munmap(producer.data, producer.data_size);
+    free(producer.spans);
+    free(producer.sent_at);
+    free(producer.latencies);
+
+    if (success == false)
+        return g_errno;
+
+    return 0;
+}
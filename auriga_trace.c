@@ -0,0 +1,280 @@
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "trace.h"
+#include "errors.h"
+#include "debug.h"
+
+#define TRACE_TOOL_PID              (1)     ///< Process id every thread of the timeline is shown under
+
+/**
+ * @brief Converter state: the trace file read and the JSON file written
+ */
+typedef struct trace_tool_s {
+    const char *input;          ///< Trace file saved by "test_is --trace"
+    const char *output;         ///< JSON file (NULL writes to stdout)
+    FILE *in;                   ///< Opened @p input
+    FILE *out;                  ///< Opened @p output
+    trace_header_t header;      ///< Header of @p input
+    uint64_t origin;            ///< Earliest begin of all events, shown as time 0
+    uint64_t events;            ///< Events converted
+    uint64_t dropped;           ///< Events the rings lost
+    uint64_t totals[TRACE_STAGES];      ///< Time spent per stage, in nanoseconds
+    uint64_t counts[TRACE_STAGES];      ///< Events per stage
+    trace_event_t slowest[TRACE_STAGES];    ///< Longest event of each stage
+} trace_tool_t;
+
+static void trace_tool_usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s -i TRACE [-o JSON]\n"
+            "Convert a trace saved by \"test_is --trace\" to the Chrome trace event format,\n"
+            "which chrome://tracing and https://ui.perfetto.dev open as a timeline.\n"
+            "  -i, --input TRACE     trace file to be converted\n"
+            "  -o, --output JSON     JSON file to be written (default: stdout)\n"
+            "  -h, --help            show this help\n",
+            program);
+}
+
+static bool trace_tool_parse(int argc, char **argv, trace_tool_t *tool)
+{
+    static const struct option long_options[] = {
+        { "input",  required_argument, NULL, 'i' },
+        { "output", required_argument, NULL, 'o' },
+        { "help",   no_argument,       NULL, 'h' },
+        { NULL,     0,                 NULL, 0   },
+    };
+    int option = 0;
+
+    while ((option = getopt_long(argc, argv, "i:o:h", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+            case 'i':
+                tool->input = optarg;
+                break;
+
+            case 'o':
+                tool->output = optarg;
+                break;
+
+            case 'h':
+                trace_tool_usage(argv[0]);
+                return false;
+
+            default:
+                trace_tool_usage(argv[0]);
+                g_errno = ERROR_DATA_NOT_EXPECTED;
+                return false;
+        }
+    }
+
+    if (optind != argc || tool->input == NULL)
+    {
+        trace_tool_usage(argv[0]);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Walk the rings of the input, calling @p visit for every event
+ */
+static bool trace_tool_walk(trace_tool_t *tool, bool (*visit)(trace_tool_t *, uint32_t, const trace_event_t *))
+{
+    trace_ring_header_t ring;
+    trace_event_t event;
+
+    if (fseek(tool->in, (long) sizeof(tool->header), SEEK_SET) != 0)
+        return false;
+
+    for (uint32_t i = 0; i < tool->header.rings; i++)
+    {
+        if (fread(&ring, sizeof(ring), 1, tool->in) != 1)
+        {
+            DEBUG_ERROR("\"%s\" is truncated in ring %" PRIu32, tool->input, i);
+            g_errno = ERROR_READING_FILE;
+            return false;
+        }
+
+        for (uint64_t j = 0; j < ring.events; j++)
+        {
+            if (fread(&event, sizeof(event), 1, tool->in) != 1)
+            {
+                DEBUG_ERROR("\"%s\" is truncated in ring %" PRIu32, tool->input, i);
+                g_errno = ERROR_READING_FILE;
+                return false;
+            }
+
+            if (visit(tool, i, &event) == false)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static bool trace_tool_scan(trace_tool_t *tool, uint32_t ring, const trace_event_t *event)
+{
+    uint8_t stage = event->stage;
+
+    (void) ring;
+
+    if (tool->events == 0 || event->begin < tool->origin)
+        tool->origin = event->begin;
+    tool->events++;
+
+    if (stage >= TRACE_STAGES)
+        return true;
+
+    tool->totals[stage] += event->end - event->begin;
+    tool->counts[stage]++;
+    if (event->end - event->begin > tool->slowest[stage].end - tool->slowest[stage].begin)
+        tool->slowest[stage] = *event;
+
+    return true;
+}
+
+static bool trace_tool_emit(trace_tool_t *tool, uint32_t ring, const trace_event_t *event)
+{
+    int wrote = fprintf(tool->out,
+                        ",\n{\"name\":\"%s\",\"cat\":\"auriga\",\"ph\":\"X\",\"pid\":%d,\"tid\":%" PRIu32
+                        ",\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"record\":%" PRIu64 ",\"count\":%" PRIu32 "}}",
+                        trace_stage_name(event->stage), TRACE_TOOL_PID, ring,
+                        (double)(event->begin - tool->origin) / 1000.0,
+                        (double)(event->end - event->begin) / 1000.0,
+                        event->record, event->count);
+
+    return wrote >= 0;
+}
+
+static bool trace_tool_threads(trace_tool_t *tool)
+{
+    trace_ring_header_t ring;
+    long skip = 0;
+
+    if (fseek(tool->in, (long) sizeof(tool->header), SEEK_SET) != 0)
+        return false;
+
+    /* one metadata event per ring, so the timeline rows are named after the threads */
+    for (uint32_t i = 0; i < tool->header.rings; i++)
+    {
+        if (fread(&ring, sizeof(ring), 1, tool->in) != 1)
+            return false;
+
+        ring.name[sizeof(ring.name) - 1] = '\0';
+        tool->dropped += ring.dropped;
+        if (fprintf(tool->out,
+                    "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%" PRIu32 ",\"args\":{\"name\":\"%s\"}}",
+                    (i == 0) ? "" : ",", TRACE_TOOL_PID, i, ring.name) < 0)
+            return false;
+
+        skip = (long)(ring.events * sizeof(trace_event_t));
+        if (fseek(tool->in, skip, SEEK_CUR) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+static bool trace_tool_open(trace_tool_t *tool)
+{
+    tool->in = fopen(tool->input, "r");
+    if (tool->in == NULL)
+    {
+        DEBUG_ERROR("File \"%s\" does not exist", tool->input);
+        g_errno = ERROR_FILE_NOT_EXIST;
+        return false;
+    }
+
+    if (fread(&tool->header, sizeof(tool->header), 1, tool->in) != 1 ||
+        memcmp(tool->header.magic, TRACE_MAGIC, sizeof(tool->header.magic)) != 0 ||
+        tool->header.version != TRACE_VERSION || tool->header.event_size != sizeof(trace_event_t))
+    {
+        DEBUG_ERROR("\"%s\" is not a trace file of this version", tool->input);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    tool->out = (tool->output == NULL) ? stdout : fopen(tool->output, "w");
+    if (tool->out == NULL)
+    {
+        DEBUG_ERROR("Creating/opening \"%s\" file", tool->output);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+
+    return true;
+}
+
+static void trace_tool_report(const trace_tool_t *tool)
+{
+    const trace_event_t *slowest = NULL;
+
+    fprintf(stderr, "%" PRIu64 " events in %" PRIu32 " threads, %" PRIu64 " dropped\n",
+            tool->events, tool->header.rings, tool->dropped);
+
+    for (uint8_t stage = 0; stage < TRACE_STAGES; stage++)
+    {
+        if (tool->counts[stage] == 0)
+            continue;
+
+        slowest = &tool->slowest[stage];
+        fprintf(stderr, "%-7s %10" PRIu64 " events, mean %9.3f us, max %9.3f us (record %" PRIu64 ")\n",
+                trace_stage_name(stage), tool->counts[stage],
+                (double) tool->totals[stage] / (double) tool->counts[stage] / 1000.0,
+                (double)(slowest->end - slowest->begin) / 1000.0, slowest->record);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    trace_tool_t tool;
+    bool success = false;
+
+    memset(&tool, 0, sizeof(tool));
+
+    if (trace_tool_parse(argc, argv, &tool) == false)
+        return g_errno;
+
+    if (trace_tool_open(&tool) == false)
+        goto cleanup;
+
+    /* a first pass finds the origin of the timeline */
+    if (trace_tool_walk(&tool, trace_tool_scan) == false)
+        goto cleanup;
+
+    if (fprintf(tool.out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") < 0 ||
+        trace_tool_threads(&tool) == false ||
+        trace_tool_walk(&tool, trace_tool_emit) == false ||
+        fprintf(tool.out, "\n]}\n") < 0)
+    {
+        DEBUG_ERROR("Could not convert \"%s\"", tool.input);
+        if (g_errno == ERROR_NO_ERROR)
+            g_errno = ERROR_FILE_CREATION;
+        goto cleanup;
+    }
+
+    trace_tool_report(&tool);
+    success = true;
+
+cleanup:
+    if (tool.in != NULL)
+        fclose(tool.in);
+    if (tool.out != NULL && tool.out != stdout && fclose(tool.out) != 0)
+    {
+        DEBUG_ERROR("Could not write into file \"%s\"", tool.output);
+        g_errno = ERROR_FILE_CREATION;
+        success = false;
+    }
+
+    if (success == false)
+        return g_errno;
+
+    return 0;
+}
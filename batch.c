@@ -0,0 +1,814 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "batch.h"
+#include "auriga.h"
+#include "cache.h"
+#include "output.h"
+#include "checkpoint.h"
+#include "quarantine.h"
+#include "partition.h"
+#include "trace.h"
+#include "shard.h"
+#include "input.h"
+#include "affinity.h"
+#include "utils.h"
+#include "errors.h"
+#include "debug.h"
+
+/**
+ * @brief State of one worker thread, formatting a contiguous range of records of the window
+ */
+typedef struct batch_worker_s {
+    pthread_t thread;                       ///< The worker thread
+    auriga_span_t *spans;                   ///< Records of the window (or of the shard)
+    size_t *offsets;                        ///< Output offset of each record, plus the end of the last one
+    auriga_result_t *results;               ///< Outcome of each record
+    size_t capacity;                        ///< Records the shard arrays can hold; 0 if they are not owned
+    size_t first;                           ///< First record of the range
+    size_t last;                            ///< One past the last record of the range
+    char *output;                           ///< Output window
+    cache_t *cache;                         ///< Cache owned by this worker (may be NULL)
+    const char *input;                      ///< Input buffer (sharded parsing)
+    size_t begin;                           ///< Start of the shard in @p input
+    size_t end;                             ///< End of the shard in @p input
+    error_e error;                          ///< Why the shard scan stopped before its end
+    size_t written;                         ///< Output bytes of the range, failing records left out
+    bool keep_going;                        ///< Failing records are left out instead of ending the range
+    uint32_t flags;                         ///< AURIGA_FLAG_* bits the records are processed with
+    size_t record;                          ///< Index in the input of the first record of the range
+    trace_ring_t *trace;                    ///< Ring the worker records its stages into (may be NULL)
+    int cpu;                                ///< CPU the worker is pinned to (AFFINITY_NONE if not pinned)
+    int node;                               ///< NUMA node the worker allocates from (AFFINITY_NONE if any)
+    void *(*routine)(void *);               ///< What the worker thread runs, see batch_worker_main()
+} batch_worker_t;
+
+/**
+ * @brief Buffers shared by all windows of a run
+ */
+typedef struct batch_s {
+    auriga_span_t *spans;                   ///< Records of the current window
+    size_t *offsets;                        ///< Output offsets of the current window, plus its total size
+    auriga_result_t *results;               ///< Outcome of each record of the current window
+    size_t *bounds;                         ///< Shard boundaries of the current window (sharded parsing)
+    batch_worker_t *workers;                ///< One per thread
+    size_t threads;                         ///< Number of workers
+    size_t window;                          ///< Maximum number of records per window
+    bool sharded;                           ///< Workers also parse their own shard of the input
+    bool pinned;                            ///< Workers are pinned, so they always run on their own thread
+    quarantine_t *quarantine;               ///< Where failing records go; NULL stops at the first one
+    partition_t *partition;                 ///< Per-type streams replacing the output file (may be NULL)
+    size_t input_offset;                    ///< Input offset of the current window
+    size_t corrected;                       ///< Records whose single-bit error was repaired
+    trace_t trace;                          ///< Rings of the writer and of the workers (empty if not traced)
+} batch_t;
+
+static size_t batch_worker_size(const batch_worker_t *worker)
+{
+    if (worker->offsets == NULL)
+        return 0;
+
+    return worker->offsets[worker->last] - worker->offsets[worker->first];
+}
+
+static void *batch_worker_run(void *argument)
+{
+    batch_worker_t *worker = argument;
+    auriga_result_t *result = NULL;
+    trace_ring_t *previous = NULL;
+    size_t expected = 0;
+    char *range = NULL;
+
+    worker->written = 0;
+    if (worker->first >= worker->last)
+        return NULL;
+
+    /* a single unpinned worker runs on the writer thread, whose ring is put back afterwards */
+    previous = trace_switch(worker->trace);
+    if (worker->trace != NULL)
+        worker->trace->base = worker->record;
+
+    /* the whole range at once, so the library can batch the CRCs of its records */
+    range = &worker->output[worker->offsets[worker->first]];
+    auriga_process_batch(&worker->spans[worker->first], worker->last - worker->first,
+                         worker->flags, worker->cache,
+                         range, worker->offsets[worker->last] - worker->offsets[worker->first],
+                         &worker->results[worker->first]);
+
+    trace_switch(previous);
+
+    /*
+     * A failing record writes nothing, so the records after it land earlier
+     * than laid out. Each one is moved up against the previous one kept.
+     */
+    for (size_t i = worker->first; i < worker->last; i++)
+    {
+        result = &worker->results[i];
+        expected = worker->offsets[i + 1] - worker->offsets[i];
+
+        if (result->error == ERROR_NO_ERROR && result->size != expected)
+            result->error = ERROR_LENGTH;
+
+        if (result->error == ERROR_NO_ERROR)
+        {
+            if (result->offset != worker->written)
+                memmove(&range[worker->written], &range[result->offset], result->size);
+            worker->written += result->size;
+        }
+        else if (worker->keep_going == false)
+        {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static bool batch_shard_reserve(batch_worker_t *worker, size_t count)
+{
+    auriga_result_t *results = NULL;
+    auriga_span_t *spans = NULL;
+    size_t *offsets = NULL;
+    size_t capacity = MAX(worker->capacity, BATCH_RECORDS_PER_WORKER);
+
+    if (count <= worker->capacity)
+        return true;
+
+    while (capacity < count)
+        capacity *= 2;
+
+    spans = realloc(worker->spans, capacity * sizeof(*spans));
+    if (spans != NULL)
+        worker->spans = spans;
+
+    offsets = realloc(worker->offsets, (capacity + 1) * sizeof(*offsets));
+    if (offsets != NULL)
+        worker->offsets = offsets;
+
+    results = realloc(worker->results, capacity * sizeof(*results));
+    if (results != NULL)
+        worker->results = results;
+
+    if (spans == NULL || offsets == NULL || results == NULL)
+        return false;
+
+    worker->capacity = capacity;
+
+    return true;
+}
+
+static void *batch_shard_scan(void *argument)
+{
+    batch_worker_t *worker = argument;
+    size_t consumed = 0;
+    size_t count = 0;
+    size_t size = 0;
+    size_t pos = worker->begin;
+    size_t got = 0;
+    error_e error = ERROR_NO_ERROR;
+
+    worker->error = ERROR_NO_ERROR;
+    worker->first = 0;
+    worker->last = 0;
+
+    while (pos < worker->end)
+    {
+        if (batch_shard_reserve(worker, count + BATCH_RECORDS_PER_WORKER) == false)
+        {
+            worker->error = ERROR_BUFFER_SIZE;
+            return NULL;
+        }
+
+        got = auriga_split_records(&worker->input[pos], worker->end - pos, true,
+                                   &worker->spans[count], worker->capacity - count, &consumed);
+        if (got == 0)
+            break;
+
+        count += got;
+        pos += consumed;
+    }
+
+    if (batch_shard_reserve(worker, count) == false)
+    {
+        worker->error = ERROR_BUFFER_SIZE;
+        return NULL;
+    }
+
+    worker->offsets[0] = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        error = auriga_output_size(worker->spans[i].data, worker->spans[i].size, &size);
+        if (error != ERROR_NO_ERROR && worker->keep_going == false)
+        {
+            worker->error = error;
+            break;
+        }
+
+        /* left to the formatting pass, which fails it with the error the full parser finds */
+        if (error != ERROR_NO_ERROR)
+            size = 0;
+
+        worker->offsets[i + 1] = worker->offsets[i] + size;
+        worker->last = i + 1;
+    }
+
+    return NULL;
+}
+
+static void *batch_worker_main(void *argument)
+{
+    batch_worker_t *worker = argument;
+
+    /* the shard arrays and the cache are first written here, so they land on the worker node */
+    if (affinity_prefer_node(worker->node) == false)
+        DEBUG_WARN("The worker buffers are not placed on node %d", worker->node);
+
+    return worker->routine(worker);
+}
+
+static bool batch_start(batch_t *batch, void *(*routine)(void *))
+{
+    pthread_attr_t attr;
+    size_t started = 0;
+    bool success = true;
+
+    if (batch->threads == 1 && batch->pinned == false)
+    {
+        routine(&batch->workers[0]);
+        return true;
+    }
+
+    for (started = 0; started < batch->threads; started++)
+    {
+        batch->workers[started].routine = routine;
+
+        pthread_attr_init(&attr);
+        success = affinity_set_attr(&attr, batch->workers[started].cpu);
+        if (success == true &&
+            pthread_create(&batch->workers[started].thread, &attr,
+                           batch_worker_main, &batch->workers[started]) != 0)
+        {
+            DEBUG_ERROR("Could not start worker %zu", started);
+            g_errno = ERROR_BUFFER_SIZE;
+            success = false;
+        }
+        pthread_attr_destroy(&attr);
+
+        if (success == false)
+            break;
+    }
+
+    for (size_t i = 0; i < started; i++)
+        pthread_join(batch->workers[i].thread, NULL);
+
+    return success;
+}
+
+static bool batch_check(batch_t *batch, const batch_worker_t *worker,
+                        const char *input, size_t first_record)
+{
+    for (size_t i = worker->first; i < worker->last; i++)
+    {
+        if (worker->results[i].corrected == true)
+            batch->corrected++;
+
+        if (worker->results[i].error == ERROR_NO_ERROR)
+            continue;
+
+        if (batch->quarantine == NULL)
+        {
+            DEBUG_ERROR("Record %zu failed", first_record + i);
+            g_errno = worker->results[i].error;
+            return false;
+        }
+
+        if (quarantine_add(batch->quarantine, first_record + i,
+                           batch->input_offset + (size_t)(worker->spans[i].data - input),
+                           worker->results[i].error, worker->spans[i].data, worker->spans[i].size) == false)
+            return false;
+    }
+
+    return true;
+}
+
+static size_t batch_gather(const batch_t *batch, char *window)
+{
+    const batch_worker_t *worker = NULL;
+    const char *range = NULL;
+    size_t total = 0;
+
+    /* closes the gaps the failing records left at the end of each range */
+    for (size_t i = 0; i < batch->threads; i++)
+    {
+        worker = &batch->workers[i];
+        if (worker->written == 0)
+            continue;
+
+        range = &worker->output[worker->offsets[worker->first]];
+        if (range != &window[total])
+            memmove(&window[total], range, worker->written);
+        total += worker->written;
+    }
+
+    return total;
+}
+
+static char *batch_reserve(batch_t *batch, output_t *output, size_t size)
+{
+    if (batch->partition != NULL)
+        return partition_reserve(batch->partition, size);
+
+    return output_reserve(output, size);
+}
+
+static bool batch_commit(batch_t *batch, output_t *output, char *window, size_t first_record)
+{
+    const batch_worker_t *worker = NULL;
+    uint64_t begin = TRACE_BEGIN();
+    size_t size = batch_gather(batch, window);
+    size_t seq = first_record;
+    bool success = true;
+
+    /* the kept blocks are back to back in record order, as the partition expects them */
+    for (size_t i = 0; i < batch->threads && batch->partition != NULL && success == true; i++)
+    {
+        worker = &batch->workers[i];
+        for (size_t j = worker->first; j < worker->last && success == true; j++, seq++)
+        {
+            if (worker->results[j].error == ERROR_NO_ERROR)
+                success = partition_queue(batch->partition, seq, worker->results[j].size);
+        }
+    }
+
+    if (success == true && batch->partition != NULL)
+        success = partition_commit(batch->partition, size);
+    else if (success == true)
+        success = output_commit(output, size);
+
+    if (success == true && g_trace_ring != NULL)
+    {
+        seq = 0;
+        for (size_t i = 0; i < batch->threads; i++)
+            seq += batch->workers[i].last - batch->workers[i].first;
+        TRACE_END(TRACE_STAGE_WRITE, begin, first_record, seq);
+    }
+
+    return success;
+}
+
+static bool batch_round_serial(batch_t *batch, const char *input, size_t size, bool final,
+                               output_t *output, size_t first_record,
+                               size_t *consumed, size_t *count)
+{
+    size_t per_worker = 0;
+    size_t length = 0;
+    error_e error = ERROR_NO_ERROR;
+    char *window = NULL;
+
+    *count = auriga_split_records(input, size, final, batch->spans, batch->window, consumed);
+    if (*count == 0)
+        return true;
+
+    batch->offsets[0] = 0;
+    for (size_t i = 0; i < *count; i++)
+    {
+        error = auriga_output_size(batch->spans[i].data, batch->spans[i].size, &length);
+        if (error != ERROR_NO_ERROR && batch->quarantine == NULL)
+        {
+            DEBUG_ERROR("Record %zu has no valid header", first_record + i);
+            g_errno = error;
+            return false;
+        }
+
+        /* left to the workers, which fail it with the error the full parser finds */
+        if (error != ERROR_NO_ERROR)
+            length = 0;
+        batch->offsets[i + 1] = batch->offsets[i] + length;
+    }
+
+    window = batch_reserve(batch, output, batch->offsets[*count]);
+    if (window == NULL)
+        return false;
+
+    per_worker = (*count + batch->threads - 1) / batch->threads;
+    for (size_t i = 0; i < batch->threads; i++)
+    {
+        batch_worker_t *worker = &batch->workers[i];
+
+        worker->spans = batch->spans;
+        worker->offsets = batch->offsets;
+        worker->results = batch->results;
+        worker->output = window;
+        worker->first = MIN(i * per_worker, *count);
+        worker->last = MIN(worker->first + per_worker, *count);
+        worker->record = first_record + worker->first;
+    }
+
+    if (batch_start(batch, batch_worker_run) == false)
+        return false;
+
+    for (size_t i = 0; i < batch->threads; i++)
+    {
+        if (batch_check(batch, &batch->workers[i], input, first_record) == false)
+            return false;
+    }
+
+    return batch_commit(batch, output, window, first_record);
+}
+
+static bool batch_round_sharded(batch_t *batch, const char *input, size_t size, bool final,
+                                output_t *output, size_t first_record,
+                                size_t *consumed, size_t *count)
+{
+    size_t target = batch->threads * BATCH_SHARD_SIZE;
+    size_t end = size;
+    size_t total = 0;
+    char *window = NULL;
+
+    /* a window that is not final may end in the middle of a record */
+    if (final == false)
+        target = MIN(target, size / 2);
+
+    if (size > target)
+        end = shard_resync(input, size, target);
+
+    if (final == false && end == size)
+    {
+        DEBUG_ERROR("No record boundary in the %zu bytes following record %zu", size - target, first_record);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    shard_split(input, 0, end, batch->threads, batch->bounds);
+    for (size_t i = 0; i < batch->threads; i++)
+    {
+        batch->workers[i].input = input;
+        batch->workers[i].begin = batch->bounds[i];
+        batch->workers[i].end = batch->bounds[i + 1];
+    }
+
+    if (batch_start(batch, batch_shard_scan) == false)
+        return false;
+
+    for (size_t i = 0; i < batch->threads; i++)
+        total += batch_worker_size(&batch->workers[i]);
+
+    window = batch_reserve(batch, output, total);
+    if (window == NULL)
+        return false;
+
+    total = 0;
+    *count = 0;
+    for (size_t i = 0; i < batch->threads; i++)
+    {
+        batch->workers[i].output = &window[total];
+        batch->workers[i].record = first_record + *count;
+        total += batch_worker_size(&batch->workers[i]);
+        *count += batch->workers[i].last;
+    }
+
+    if (batch_start(batch, batch_worker_run) == false)
+        return false;
+
+    *count = 0;
+    for (size_t i = 0; i < batch->threads; i++)
+    {
+        if (batch_check(batch, &batch->workers[i], input, first_record + *count) == false)
+            return false;
+
+        *count += batch->workers[i].last;
+
+        if (batch->workers[i].error != ERROR_NO_ERROR)
+        {
+            DEBUG_ERROR("Record %zu has no valid header", first_record + *count);
+            g_errno = batch->workers[i].error;
+            return false;
+        }
+    }
+
+    *consumed = end;
+
+    return batch_commit(batch, output, window, first_record);
+}
+
+static bool batch_checkpoint(const options_t *options, output_t *output, quarantine_t *quarantine,
+                             checkpoint_t *checkpoint, size_t input_offset, size_t records)
+{
+    if (output_sync(output) == false)
+        return false;
+
+    if (quarantine != NULL && quarantine_sync(quarantine) == false)
+        return false;
+
+    checkpoint->input_offset = input_offset;
+    checkpoint->output_offset = output->offset;
+    checkpoint->records = records;
+    checkpoint->quarantine_offset = (quarantine != NULL) ? quarantine->offset : 0;
+
+    return checkpoint_save(options->checkpoint, checkpoint);
+}
+
+static void batch_report_cache(const batch_t *batch)
+{
+    cache_stats_t total = {0};
+    cache_stats_t stats;
+
+    for (size_t i = 0; i < batch->threads; i++)
+    {
+        if (batch->workers[i].cache == NULL)
+            return;
+
+        cache_get_stats(batch->workers[i].cache, &stats);
+        total.hits += stats.hits;
+        total.misses += stats.misses;
+        total.evictions += stats.evictions;
+        total.entries += stats.entries;
+        total.capacity += stats.capacity;
+    }
+
+    DEBUG_INFO("Cache: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " evictions, %zu/%zu entries",
+               total.hits, total.misses, total.evictions, total.entries, total.capacity);
+}
+
+static bool batch_init(batch_t *batch, const options_t *options)
+{
+    affinity_t cpus = options->worker_cpus;
+    char name[TRACE_NAME_SIZE] = {0};
+    trace_ring_t *writer = NULL;
+
+    memset(batch, 0, sizeof(*batch));
+    batch->threads = options->threads;
+    batch->sharded = options->sharded;
+    batch->pinned = (cpus.count != 0);
+    batch->window = BATCH_RECORDS_PER_WORKER * batch->threads;
+
+    batch->workers = calloc(batch->threads, sizeof(*batch->workers));
+    if (batch->workers == NULL)
+    {
+        DEBUG_ERROR("Could not allocate the batch workers");
+        g_errno = ERROR_BUFFER_SIZE;
+        return false;
+    }
+
+    /*
+     * Neighbouring workers get neighbouring shards of the input and of the
+     * output, so with --numa the workers of a node are kept next to each other.
+     */
+    if (options->numa == true)
+        affinity_group_by_node(&cpus);
+
+    for (size_t i = 0; i < batch->threads; i++)
+    {
+        batch->workers[i].cpu = affinity_cpu(&cpus, i);
+        batch->workers[i].node = (options->numa == true) ? affinity_node(batch->workers[i].cpu) : AFFINITY_NONE;
+        batch->workers[i].keep_going = (options->quarantine != NULL);
+        batch->workers[i].flags = (options->correct == true) ? AURIGA_FLAG_CORRECT_CRC : 0;
+    }
+
+    if (batch->sharded == true)
+    {
+        batch->bounds = calloc(batch->threads + 1, sizeof(*batch->bounds));
+        if (batch->bounds == NULL)
+        {
+            DEBUG_ERROR("Could not allocate the shard boundaries");
+            g_errno = ERROR_BUFFER_SIZE;
+            return false;
+        }
+    }
+    else
+    {
+        batch->spans = calloc(batch->window, sizeof(*batch->spans));
+        batch->offsets = calloc(batch->window + 1, sizeof(*batch->offsets));
+        batch->results = calloc(batch->window, sizeof(*batch->results));
+        if (batch->spans == NULL || batch->offsets == NULL || batch->results == NULL)
+        {
+            DEBUG_ERROR("Could not allocate the batch buffers");
+            g_errno = ERROR_BUFFER_SIZE;
+            return false;
+        }
+    }
+
+    if (options->trace != NULL)
+    {
+        if (trace_open(&batch->trace, options->trace_events) == false)
+            return false;
+
+        /* this thread commits the windows */
+        writer = trace_ring(&batch->trace, "writer");
+        if (writer == NULL)
+            return false;
+        trace_switch(writer);
+
+        for (size_t i = 0; i < batch->threads; i++)
+        {
+            snprintf(name, sizeof(name), "worker %u", (uint16_t) i);
+            batch->workers[i].trace = trace_ring(&batch->trace, name);
+            if (batch->workers[i].trace == NULL)
+                return false;
+        }
+    }
+
+    for (size_t i = 0; i < batch->threads && options->cache_entries != 0; i++)
+    {
+        batch->workers[i].cache = cache_create(options->cache_entries);
+        if (batch->workers[i].cache == NULL)
+        {
+            g_errno = ERROR_BUFFER_SIZE;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void batch_deinit(batch_t *batch)
+{
+    for (size_t i = 0; i < batch->threads && batch->workers != NULL; i++)
+    {
+        cache_destroy(batch->workers[i].cache);
+
+        if (batch->workers[i].capacity != 0)
+        {
+            free(batch->workers[i].spans);
+            free(batch->workers[i].offsets);
+            free(batch->workers[i].results);
+        }
+    }
+
+    trace_switch(NULL);
+    trace_close(&batch->trace);
+
+    free(batch->workers);
+    free(batch->bounds);
+    free(batch->results);
+    free(batch->offsets);
+    free(batch->spans);
+}
+
+bool batch_run(const options_t *options)
+{
+    checkpoint_t checkpoint;
+    quarantine_t quarantine;
+    partition_t partition;
+    const char *data = NULL;
+    output_t output;
+    input_t input;
+    batch_t batch;
+    size_t consumed = 0;
+    size_t records = 0;
+    size_t pending = 0;
+    size_t count = 0;
+    size_t size = 0;
+    bool opened = false;
+    bool quarantined = false;
+    bool partitioned = false;
+    bool success = false;
+    bool processed = false;
+    bool final = false;
+    int writer_cpu = AFFINITY_NONE;
+    int reader_cpu = AFFINITY_NONE;
+
+    if (options == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    /* this thread writes the output */
+    writer_cpu = affinity_cpu(&options->writer_cpus, 0);
+    if (affinity_pin_self(writer_cpu) == false)
+        return false;
+    if (options->numa == true && affinity_prefer_node(affinity_node(writer_cpu)) == false)
+        DEBUG_WARN("The output buffers are not placed on the node of CPU %d", writer_cpu);
+
+    reader_cpu = affinity_cpu(&options->reader_cpus, 0);
+    if (input_open(&input, options->input, reader_cpu,
+                   (options->numa == true) ? affinity_node(reader_cpu) : AFFINITY_NONE) == false)
+        return false;
+
+    if (batch_init(&batch, options) == false)
+        goto cleanup;
+
+    memset(&checkpoint, 0, sizeof(checkpoint));
+    if (options->resume == true)
+    {
+        if (checkpoint_load(options->checkpoint, &checkpoint) == false)
+            goto cleanup;
+
+        if (checkpoint.input_size != input.file_size ||
+            checkpoint.input_compressed != (input.mode == INPUT_MODE_GZIP))
+        {
+            DEBUG_ERROR("Checkpoint was taken over a different input (%zu bytes%s, now %zu%s)",
+                        checkpoint.input_size, (checkpoint.input_compressed == true) ? " of gzip" : "",
+                        input.file_size, (input.mode == INPUT_MODE_GZIP) ? " of gzip" : "");
+            g_errno = ERROR_DATA_NOT_EXPECTED;
+            goto cleanup;
+        }
+
+        DEBUG_INFO("Resuming after %zu records (input offset %zu, output offset %zu)",
+                   checkpoint.records, checkpoint.input_offset, checkpoint.output_offset);
+        if (input_skip(&input, checkpoint.input_offset) == false)
+            goto cleanup;
+        records = checkpoint.records;
+    }
+    checkpoint.input_size = input.file_size;
+    checkpoint.input_compressed = (input.mode == INPUT_MODE_GZIP);
+
+    if (options->partition == true)
+    {
+        partitioned = partition_open(&partition, options->output);
+        if (partitioned == false)
+            goto cleanup;
+        batch.partition = &partition;
+    }
+    else
+    {
+        opened = output_open(&output, options, checkpoint.output_offset);
+        if (opened == false)
+            goto cleanup;
+    }
+
+    if (options->quarantine != NULL)
+    {
+        quarantined = quarantine_open(&quarantine, options->quarantine, checkpoint.quarantine_offset);
+        if (quarantined == false)
+            goto cleanup;
+        batch.quarantine = &quarantine;
+    }
+
+    while (true)
+    {
+        if (input_window(&input, &data, &size, &final) == false)
+            goto cleanup;
+
+        if (size == 0)
+            break;
+
+        consumed = 0;
+        count = 0;
+        batch.input_offset = input.offset;
+
+        if (batch.sharded == true)
+            processed = batch_round_sharded(&batch, data, size, final,
+                                            &output, records, &consumed, &count);
+        else
+            processed = batch_round_serial(&batch, data, size, final,
+                                           &output, records, &consumed, &count);
+
+        if (processed == false)
+            goto cleanup;
+
+        if (consumed == 0)
+        {
+            if (final == true)
+                break;
+
+            DEBUG_ERROR("Record %zu does not fit in the input window", records);
+            g_errno = ERROR_DATA_NOT_EXPECTED;
+            goto cleanup;
+        }
+
+        input_consume(&input, consumed);
+        records += count;
+        pending += count;
+
+        if (options->checkpoint != NULL && pending >= options->checkpoint_interval)
+        {
+            if (batch_checkpoint(options, &output, batch.quarantine, &checkpoint, input.offset, records) == false)
+                goto cleanup;
+            pending = 0;
+        }
+    }
+
+    if (options->checkpoint != NULL && batch_checkpoint(options, &output, batch.quarantine, &checkpoint, input.offset, records) == false)
+        goto cleanup;
+
+    DEBUG_INFO("Processed %zu records", records);
+    batch_report_cache(&batch);
+    if (batch.corrected != 0)
+        DEBUG_WARN("Corrected a single-bit error in %zu records", batch.corrected);
+    if (partitioned == true)
+        partition_report(&partition);
+    if (quarantined == true)
+        quarantine_report(&quarantine);
+    success = true;
+
+cleanup:
+    if (opened == true && output_close(&output) == false)
+        success = false;
+    if (partitioned == true && partition_close(&partition) == false)
+        success = false;
+    if (quarantined == true && quarantine_close(&quarantine) == false)
+        success = false;
+    /* also when the run failed, as the trace shows where it stopped */
+    if (batch.trace.count != 0 && trace_save(&batch.trace, options->trace) == false)
+        success = false;
+    batch_deinit(&batch);
+    input_close(&input);
+
+    return success;
+}
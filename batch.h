@@ -0,0 +1,37 @@
+#ifndef BATCH_H__
+#define BATCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "options.h"
+
+#define BATCH_RECORDS_PER_WORKER    (size_t)UINT16_C(4096)  ///< Records each worker formats per window
+#define BATCH_SHARD_SIZE            (size_t)UINT32_C(4194304)   ///< Input bytes each worker parses per window (sharded parsing)
+
+/**
+ * @brief Process every record of the input file and write all output blocks into the output file
+ *
+ * The input is processed in windows: the output size of every record of a
+ * window is computed from its header, the records are split into one
+ * contiguous range per worker thread, and each worker formats its range
+ * straight into its part of the output window.
+ * With sharded parsing the window is a slice of the input instead: it is
+ * cut into one byte range per worker, each resynchronized at a record
+ * boundary, and the workers also split and size their own range. The
+ * output of each range is placed after the previous ones, so the output
+ * stays in input order.
+ * Processing stops at the first record that fails, with g_errno set.
+ *
+ * When a checkpoint file is given, the input and output offsets are saved
+ * in it every checkpoint interval, once the output up to them is on disk.
+ * A resumed run truncates the output to the saved offset and continues
+ * from the saved input offset.
+ *
+ * @param[in] options The application options (input, output, cache, ...)
+ *
+ * @retval True if every record was processed; false otherwise
+ */
+bool batch_run(const options_t *options);
+
+#endif /* BATCH_H__ */
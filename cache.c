@@ -0,0 +1,209 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "errors.h"
+#include "debug.h"
+
+#define CACHE_HASH_SEED             UINT64_C(0x9E3779B97F4A7C15)    ///< Seed of the record hash
+#define CACHE_HASH_PRIME            UINT64_C(0xFF51AFD7ED558CCD)    ///< Multiplier of the record hash
+
+/**
+ * @brief One cached record and its output block
+ */
+typedef struct cache_entry_s {
+    uint64_t hash;                          ///< Hash of the raw record
+    uint64_t used;                          ///< Tick of the last access; 0 if the entry is free
+    uint16_t key_size;                      ///< Size of the raw record
+    uint16_t value_size;                    ///< Size of the output block
+    char key[CACHE_KEY_MAX_SIZE];           ///< The raw record
+    char value[CACHE_VALUE_MAX_SIZE];       ///< The output block
+} cache_entry_t;
+
+struct cache_s {
+    cache_entry_t *entries;                 ///< sets * CACHE_WAYS entries
+    size_t sets;                            ///< Number of sets, power of two
+    uint64_t tick;                          ///< Access counter used for LRU
+    cache_stats_t stats;                    ///< Counters
+};
+
+static uint64_t cache_hash(const char *key, size_t key_size)
+{
+    uint64_t hash = CACHE_HASH_SEED ^ key_size;
+    uint64_t word = 0;
+    size_t i = 0;
+
+    for (i = 0; i + sizeof(word) <= key_size; i += sizeof(word))
+    {
+        memcpy(&word, &key[i], sizeof(word));
+        hash = (hash ^ word) * CACHE_HASH_PRIME;
+        hash ^= hash >> 32;
+    }
+
+    word = 0;
+    memcpy(&word, &key[i], key_size - i);
+    hash = (hash ^ word) * CACHE_HASH_PRIME;
+    hash ^= hash >> 29;
+
+    return hash;
+}
+
+static cache_entry_t *cache_set(cache_t *cache, uint64_t hash)
+{
+    return &cache->entries[(hash & (cache->sets - 1)) * CACHE_WAYS];
+}
+
+cache_t *cache_create(size_t capacity)
+{
+    cache_t *cache = NULL;
+    size_t sets = 1;
+
+    if (capacity > CACHE_MAX_ENTRIES)
+    {
+        DEBUG_ERROR("A cache holds at most %zu entries", CACHE_MAX_ENTRIES);
+        g_errno = ERROR_BUFFER_SIZE;
+        return NULL;
+    }
+
+    /* CACHE_MAX_ENTRIES is a power of two multiple of CACHE_WAYS, so this stops there at the latest */
+    while (sets * CACHE_WAYS < capacity)
+        sets <<= 1;
+
+    cache = calloc(1, sizeof(*cache));
+    if (cache == NULL)
+    {
+        DEBUG_ERROR("Could not allocate the cache");
+        return NULL;
+    }
+
+    cache->entries = calloc(sets * CACHE_WAYS, sizeof(cache_entry_t));
+    if (cache->entries == NULL)
+    {
+        DEBUG_ERROR("Could not allocate %zu cache entries", sets * CACHE_WAYS);
+        free(cache);
+        return NULL;
+    }
+
+    cache->sets = sets;
+    cache->stats.capacity = sets * CACHE_WAYS;
+
+    return cache;
+}
+
+void cache_destroy(cache_t *cache)
+{
+    if (cache == NULL)
+        return;
+
+    free(cache->entries);
+    free(cache);
+}
+
+bool cache_lookup(cache_t *cache, const char *key, size_t key_size, const char **value, size_t *value_size)
+{
+    cache_entry_t *set = NULL;
+    uint64_t hash = 0;
+
+    if (cache == NULL || key == NULL || value == NULL || value_size == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    if (key_size > CACHE_KEY_MAX_SIZE)
+    {
+        cache->stats.misses++;
+        return false;
+    }
+
+    hash = cache_hash(key, key_size);
+    set = cache_set(cache, hash);
+
+    for (size_t i = 0; i < CACHE_WAYS; i++)
+    {
+        if (set[i].used == 0 || set[i].hash != hash || set[i].key_size != key_size)
+            continue;
+
+        if (memcmp(set[i].key, key, key_size) != 0)
+            continue;
+
+        set[i].used = ++cache->tick;
+        *value = set[i].value;
+        *value_size = set[i].value_size;
+        cache->stats.hits++;
+
+        return true;
+    }
+
+    cache->stats.misses++;
+
+    return false;
+}
+
+bool cache_insert(cache_t *cache, const char *key, size_t key_size, const char *value, size_t value_size)
+{
+    cache_entry_t *victim = NULL;
+    cache_entry_t *set = NULL;
+    uint64_t hash = 0;
+
+    if (cache == NULL || key == NULL || value == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    if (key_size > CACHE_KEY_MAX_SIZE || value_size > CACHE_VALUE_MAX_SIZE)
+        return false;
+
+    hash = cache_hash(key, key_size);
+    set = cache_set(cache, hash);
+
+    /* a record already stored (twice in the same batch, say) is refreshed instead of taking a second way */
+    for (size_t i = 0; i < CACHE_WAYS; i++)
+    {
+        if (set[i].used != 0 && set[i].hash == hash && set[i].key_size == key_size &&
+            memcmp(set[i].key, key, key_size) == 0)
+        {
+            victim = &set[i];
+            break;
+        }
+    }
+
+    if (victim == NULL)
+    {
+        victim = &set[0];
+        for (size_t i = 0; i < CACHE_WAYS; i++)
+        {
+            if (set[i].used < victim->used)
+                victim = &set[i];
+        }
+
+        if (victim->used == 0)
+            cache->stats.entries++;
+        else
+            cache->stats.evictions++;
+    }
+
+    victim->hash = hash;
+    victim->used = ++cache->tick;
+    victim->key_size = (uint16_t) key_size;
+    victim->value_size = (uint16_t) value_size;
+    memcpy(victim->key, key, key_size);
+    memcpy(victim->value, value, value_size);
+
+    return true;
+}
+
+void cache_get_stats(const cache_t *cache, cache_stats_t *stats)
+{
+    if (cache == NULL || stats == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return;
+    }
+
+    *stats = cache->stats;
+}
@@ -0,0 +1,83 @@
+#ifndef CACHE_H__
+#define CACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CACHE_WAYS                  (size_t)UINT8_C(4)      ///< Entries per set; the least recently used one is evicted
+#define CACHE_KEY_MAX_SIZE          (size_t)UINT16_C(576)   ///< Longest raw record that can be cached
+#define CACHE_VALUE_MAX_SIZE        (size_t)UINT16_C(2048)  ///< Longest output block that can be cached
+#define CACHE_MAX_ENTRIES           (size_t)UINT32_C(1048576)   ///< Largest capacity a cache can be created with
+
+/**
+ * @brief Bounded cache mapping a raw record to its formatted output block
+ */
+typedef struct cache_s cache_t;
+
+/**
+ * @brief Counters kept by the cache
+ */
+typedef struct cache_stats_s {
+    uint64_t hits;          ///< Lookups that found the record
+    uint64_t misses;        ///< Lookups that did not find the record
+    uint64_t evictions;     ///< Entries dropped to make room for new ones
+    size_t entries;         ///< Entries currently stored
+    size_t capacity;        ///< Maximum number of entries
+} cache_stats_t;
+
+/**
+ * @brief Allocate a cache
+ *
+ * @param[in] capacity Maximum number of entries, up to CACHE_MAX_ENTRIES; rounded up to a power of two multiple of CACHE_WAYS
+ *
+ * @retval Returns the cache, or NULL if @p capacity is too large or it could not be allocated
+ */
+cache_t *cache_create(size_t capacity);
+
+/**
+ * @brief Release the cache and all its entries
+ *
+ * @param[in] cache The cache to be released (may be NULL)
+ */
+void cache_destroy(cache_t *cache);
+
+/**
+ * @brief Look the given raw record up in the cache
+ *
+ * The cache is not thread-safe: each thread must use its own.
+ *
+ * @param[in] cache The cache to look into
+ * @param[in] key The raw record bytes
+ * @param[in] key_size The size of @p key buffer
+ * @param[out] value Points to the cached output block on a hit; valid until the next cache_insert()
+ * @param[out] value_size The size of the cached output block
+ *
+ * @retval True if found; false otherwise
+ */
+bool cache_lookup(cache_t *cache, const char *key, size_t key_size, const char **value, size_t *value_size);
+
+/**
+ * @brief Store the output block of the given raw record, evicting the oldest entry of its set if needed
+ *
+ * A record already in the cache has its entry replaced rather than stored twice.
+ *
+ * @param[in] cache The cache to store into
+ * @param[in] key The raw record bytes
+ * @param[in] key_size The size of @p key buffer
+ * @param[in] value The output block
+ * @param[in] value_size The size of @p value buffer
+ *
+ * @retval True if stored; false if the record or output is too large to be cached
+ */
+bool cache_insert(cache_t *cache, const char *key, size_t key_size, const char *value, size_t value_size);
+
+/**
+ * @brief Read the cache counters
+ *
+ * @param[in] cache The cache to read from
+ * @param[out] stats Where the counters are copied to
+ */
+void cache_get_stats(const cache_t *cache, cache_stats_t *stats);
+
+#endif /* CACHE_H__ */
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "errors.h"
+#include "debug.h"
+
+#define CHECKPOINT_MAGIC            ("auriga-checkpoint 2")     ///< First line of a checkpoint file
+#define CHECKPOINT_FILENAME_SIZE    (size_t)UINT16_C(4096)      ///< Maximum size of the temporary filename
+
+bool checkpoint_save(const char *filename, const checkpoint_t *checkpoint)
+{
+    char temporary[CHECKPOINT_FILENAME_SIZE] = {0};
+    FILE *fp = NULL;
+    int wrote = 0;
+
+    if (filename == NULL || checkpoint == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    wrote = snprintf(temporary, sizeof(temporary), "%s.tmp", filename);
+    if (wrote < 0 || (size_t) wrote >= sizeof(temporary))
+    {
+        DEBUG_ERROR("Checkpoint filename is too long");
+        g_errno = ERROR_BUFFER_SIZE;
+        return false;
+    }
+
+    fp = fopen(temporary, "w");
+    if (fp == NULL)
+    {
+        DEBUG_ERROR("Creating/opening \"%s\" file", temporary);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+
+    fprintf(fp, "%s\ninput_size=%zu\ninput_offset=%zu\noutput_offset=%zu\nrecords=%zu\nquarantine_offset=%zu\n"
+            "input_compressed=%d\n",
+            CHECKPOINT_MAGIC, checkpoint->input_size, checkpoint->input_offset,
+            checkpoint->output_offset, checkpoint->records, checkpoint->quarantine_offset,
+            (checkpoint->input_compressed == true) ? 1 : 0);
+
+    if (fflush(fp) != 0 || fsync(fileno(fp)) != 0)
+    {
+        DEBUG_ERROR("Could not write into file \"%s\"", temporary);
+        fclose(fp);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+    fclose(fp);
+
+    if (rename(temporary, filename) != 0)
+    {
+        DEBUG_ERROR("Could not rename \"%s\" to \"%s\"", temporary, filename);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+
+    return true;
+}
+
+bool checkpoint_load(const char *filename, checkpoint_t *checkpoint)
+{
+    char magic[sizeof(CHECKPOINT_MAGIC) + 1] = {0};
+    FILE *fp = NULL;
+    int compressed = 0;
+    int read = 0;
+
+    if (filename == NULL || checkpoint == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    fp = fopen(filename, "r");
+    if (fp == NULL)
+    {
+        DEBUG_ERROR("Could not open file \"%s\"", filename);
+        g_errno = ERROR_FILE_NOT_EXIST;
+        return false;
+    }
+
+    if (fgets(magic, sizeof(magic), fp) == NULL ||
+        strncmp(magic, CHECKPOINT_MAGIC, strlen(CHECKPOINT_MAGIC)) != 0)
+    {
+        DEBUG_ERROR("File \"%s\" is not a checkpoint", filename);
+        fclose(fp);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    /* every line is needed: a missing quarantine offset would truncate the quarantine file on resume */
+    read = fscanf(fp, "input_size=%zu\ninput_offset=%zu\noutput_offset=%zu\nrecords=%zu\n"
+                  "quarantine_offset=%zu\ninput_compressed=%d\n",
+                  &checkpoint->input_size, &checkpoint->input_offset,
+                  &checkpoint->output_offset, &checkpoint->records,
+                  &checkpoint->quarantine_offset, &compressed);
+    checkpoint->input_compressed = (compressed != 0);
+    fclose(fp);
+
+    /* a decompressed offset is not bounded by the size of the compressed file */
+    if (read != 6 || (compressed != 0 && compressed != 1) ||
+        (checkpoint->input_compressed == false && checkpoint->input_offset > checkpoint->input_size))
+    {
+        DEBUG_ERROR("Checkpoint \"%s\" is corrupted", filename);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef CHECKPOINT_H__
+#define CHECKPOINT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Progress of a batch run that is known to be on disk
+ */
+typedef struct checkpoint_s {
+    size_t input_size;      ///< Size of the input file, to refuse resuming over a different input
+    bool input_compressed;  ///< The input is gzip, so @p input_offset counts decompressed bytes and may exceed @p input_size
+    size_t input_offset;    ///< Input bytes fully processed
+    size_t output_offset;   ///< Output bytes written for them
+    size_t records;         ///< Records fully processed
+    size_t quarantine_offset;   ///< Quarantine file bytes written for them (0 without a quarantine)
+} checkpoint_t;
+
+/**
+ * @brief Atomically replace the checkpoint file with the given progress
+ *
+ * The progress is written into a temporary file, synced and renamed over
+ * @p filename, so the checkpoint file is always either the old or the new one.
+ *
+ * @param[in] filename The checkpoint file
+ * @param[in] checkpoint The progress to be saved
+ *
+ * @retval True if success; false otherwise
+ */
+bool checkpoint_save(const char *filename, const checkpoint_t *checkpoint);
+
+/**
+ * @brief Read the progress saved in the checkpoint file
+ *
+ * @param[in] filename The checkpoint file
+ * @param[out] checkpoint Where the progress is stored
+ *
+ * @retval True if success; false otherwise
+ */
+bool checkpoint_load(const char *filename, checkpoint_t *checkpoint);
+
+#endif /* CHECKPOINT_H__ */
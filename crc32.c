@@ -1,8 +1,260 @@
+#define _LARGEFILE64_SOURCE    /* crc32_combine_gen64() and z_off64_t in zlib.h */
+#include <string.h>
+#include <pthread.h>
 #include <zlib.h>
 
 #include "crc32.h"
 
+#define CRC32_REFLECTED_POLYNOME    UINT32_C(0xEDB88320)    ///< CRC32_POLYNOME with its bits reversed (zlib bit order)
+#define CRC32_TABLES                (8)                     ///< Slicing-by-8: one table per byte of a 64-bit word
+#define CRC32_SYNDROMES             (4096)                  ///< Slots of the syndrome table, a power of two above 8 * CRC32_LOCATE_MAX_SIZE
+
+/**
+ * @brief Part of a buffer whose CRC is done by its own thread, see crc32_calculate_parallel()
+ */
+typedef struct crc32_segment_s {
+    pthread_t thread;       ///< The thread doing the segment
+    const char *src;        ///< First byte of the segment
+    size_t size;            ///< Size of the segment
+    uint32_t crc;           ///< CRC of the segment alone, zlib convention (from 0)
+    bool started;           ///< The thread was started, so it must be joined
+} crc32_segment_t;
+
+/**
+ * @brief Slot of the syndrome table, see crc32_locate_error()
+ */
+typedef struct crc32_syndrome_s {
+    uint32_t syndrome;      ///< Change of the CRC caused by the bit
+    uint16_t distance;      ///< Bits from the flipped one to the end of the data, plus one; 0 if the slot is free
+} crc32_syndrome_t;
+
+static uint32_t g_crc32_tables[CRC32_TABLES][256];
+static pthread_once_t g_crc32_tables_once = PTHREAD_ONCE_INIT;
+static crc32_syndrome_t g_crc32_syndromes[CRC32_SYNDROMES];
+static pthread_once_t g_crc32_syndromes_once = PTHREAD_ONCE_INIT;
+
+static void crc32_build_tables(void)
+{
+    uint32_t crc = 0;
+
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        crc = i;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32_REFLECTED_POLYNOME : crc >> 1;
+        g_crc32_tables[0][i] = crc;
+    }
+
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        for (int table = 1; table < CRC32_TABLES; table++)
+            g_crc32_tables[table][i] = (g_crc32_tables[table - 1][i] >> 8) ^
+                                       g_crc32_tables[0][g_crc32_tables[table - 1][i] & 0xff];
+    }
+}
+
+static uint32_t crc32_byte(uint32_t crc, uint8_t byte)
+{
+    return (crc >> 8) ^ g_crc32_tables[0][(crc ^ byte) & 0xff];
+}
+
+static uint32_t crc32_word(uint32_t crc, const uint8_t *src)
+{
+    uint64_t word = 0;
+    uint32_t low = 0;
+    uint32_t high = 0;
+
+    memcpy(&word, src, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    low = crc ^ (uint32_t) word;
+    high = (uint32_t)(word >> 32);
+
+    return g_crc32_tables[7][low & 0xff] ^
+           g_crc32_tables[6][(low >> 8) & 0xff] ^
+           g_crc32_tables[5][(low >> 16) & 0xff] ^
+           g_crc32_tables[4][low >> 24] ^
+           g_crc32_tables[3][high & 0xff] ^
+           g_crc32_tables[2][(high >> 8) & 0xff] ^
+           g_crc32_tables[1][(high >> 16) & 0xff] ^
+           g_crc32_tables[0][high >> 24];
+}
+
+static uint32_t crc32_update(uint32_t crc, const char *src, size_t size)
+{
+    return (uint32_t) crc32_z(crc, (const Bytef *) src, size);
+}
+
+static void crc32_build_syndromes(void)
+{
+    uint32_t syndrome = 0;
+    size_t slot = 0;
+
+    /*
+     * The CRC is linear, so flipping a bit changes it by the CRC (without
+     * initial value nor final xor) of the bit followed by the rest of the
+     * data. The last bit (bit 7 of the last byte) goes through the 8 shifts
+     * of its byte, and each bit before it through one more shift.
+     */
+    syndrome = 0x80;
+    for (int shift = 0; shift < 8; shift++)
+        syndrome = (syndrome & 1) ? (syndrome >> 1) ^ CRC32_REFLECTED_POLYNOME : syndrome >> 1;
+
+    for (size_t distance = 0; distance < CRC32_LOCATE_MAX_SIZE * 8; distance++)
+    {
+        slot = syndrome & (CRC32_SYNDROMES - 1);
+        while (g_crc32_syndromes[slot].distance != 0)
+            slot = (slot + 1) & (CRC32_SYNDROMES - 1);
+
+        g_crc32_syndromes[slot].syndrome = syndrome;
+        g_crc32_syndromes[slot].distance = (uint16_t)(distance + 1);
+
+        syndrome = (syndrome & 1) ? (syndrome >> 1) ^ CRC32_REFLECTED_POLYNOME : syndrome >> 1;
+    }
+}
+
+bool crc32_locate_error(size_t size, uint32_t syndrome, size_t *bit)
+{
+    size_t slot = syndrome & (CRC32_SYNDROMES - 1);
+    size_t distance = 0;
+
+    if (bit == NULL || size > CRC32_LOCATE_MAX_SIZE || syndrome == 0)
+        return false;
+
+    /* one bit of the received CRC */
+    if ((syndrome & (syndrome - 1)) == 0)
+    {
+        *bit = size * 8 + (size_t) __builtin_ctz(syndrome);
+        return true;
+    }
+
+    pthread_once(&g_crc32_syndromes_once, crc32_build_syndromes);
+
+    for (; g_crc32_syndromes[slot].distance != 0; slot = (slot + 1) & (CRC32_SYNDROMES - 1))
+    {
+        if (g_crc32_syndromes[slot].syndrome != syndrome)
+            continue;
+
+        distance = g_crc32_syndromes[slot].distance - 1u;
+        if (distance >= size * 8)
+            return false;
+
+        /* bits are counted from the least significant one of each byte, the first to enter the CRC */
+        *bit = (size - 1 - distance / 8) * 8 + (7 - distance % 8);
+        return true;
+    }
+
+    return false;
+}
+
 uint32_t crc32_calculate(const char *src, size_t size)
 {
-    return (uint32_t) crc32(CRC32_INIT_VALUE, (const Bytef *) src, (uInt) size);
+    return crc32_update(CRC32_INIT_VALUE, src, size);
+}
+
+static void *crc32_segment_run(void *argument)
+{
+    crc32_segment_t *segment = argument;
+
+    segment->crc = crc32_update(0, segment->src, segment->size);
+
+    return NULL;
+}
+
+uint32_t crc32_calculate_parallel(const char *src, size_t size, size_t threads)
+{
+    crc32_segment_t segments[CRC32_PARALLEL_MAX_THREADS];
+    size_t count = (threads < CRC32_PARALLEL_MAX_THREADS) ? threads : CRC32_PARALLEL_MAX_THREADS;
+    size_t length = 0;
+#if ZLIB_VERNUM >= 0x12c0
+    uLong op = 0;
+#endif
+    uint32_t crc = 0;
+
+    if (count > size / CRC32_PARALLEL_MIN_SEGMENT)
+        count = size / CRC32_PARALLEL_MIN_SEGMENT;
+
+    if (src == NULL || count <= 1)
+        return crc32_update(CRC32_INIT_VALUE, src, size);
+
+    /* equal segments, the last one also taking the remainder */
+    length = size / count;
+    for (size_t i = 1; i < count; i++)
+    {
+        segments[i].src = &src[i * length];
+        segments[i].size = (i == count - 1) ? size - i * length : length;
+        segments[i].started = (pthread_create(&segments[i].thread, NULL, crc32_segment_run, &segments[i]) == 0);
+    }
+
+    crc = crc32_update(CRC32_INIT_VALUE, src, length);
+
+    /*
+     * crc32(c, A + B) is crc32(c, A) shifted over the length of B, xored with
+     * crc32(0, B): the shift only depends on the length, so it is generated
+     * once for the equal segments. zlib before 1.2.12 can only combine, which
+     * builds the shift again every time.
+     */
+#if ZLIB_VERNUM >= 0x12c0
+    op = crc32_combine_gen64((z_off64_t) length);
+#endif
+    for (size_t i = 1; i < count; i++)
+    {
+        if (segments[i].started == true)
+            pthread_join(segments[i].thread, NULL);
+        else
+            crc32_segment_run(&segments[i]);
+
+#if ZLIB_VERNUM >= 0x12c0
+        if (segments[i].size != length)
+            op = crc32_combine_gen64((z_off64_t) segments[i].size);
+        crc = (uint32_t) crc32_combine_op(crc, segments[i].crc, op);
+#else
+        crc = (uint32_t) crc32_combine64(crc, segments[i].crc, (z_off64_t) segments[i].size);
+#endif
+    }
+
+    return crc;
+}
+
+void crc32_calculate_multi(const char * const *srcs, const size_t *sizes, size_t count, uint32_t *crcs)
+{
+    const uint8_t *src[CRC32_MAX_LANES] = {0};
+    uint32_t crc[CRC32_MAX_LANES] = {0};
+    size_t common = SIZE_MAX;
+    size_t lanes = (count < CRC32_MAX_LANES) ? count : CRC32_MAX_LANES;
+    size_t pos = 0;
+
+    if (srcs == NULL || sizes == NULL || crcs == NULL || lanes == 0)
+        return;
+
+    pthread_once(&g_crc32_tables_once, crc32_build_tables);
+
+    for (size_t lane = 0; lane < lanes; lane++)
+    {
+        src[lane] = (const uint8_t *) srcs[lane];
+        crc[lane] = CRC32_INIT_VALUE ^ UINT32_C(0xFFFFFFFF);
+        if (sizes[lane] < common)
+            common = sizes[lane];
+    }
+
+    /* the words every buffer has, one independent chain per lane */
+    for (pos = 0; pos + sizeof(uint64_t) <= common; pos += sizeof(uint64_t))
+    {
+        for (size_t lane = 0; lane < lanes; lane++)
+            crc[lane] = crc32_word(crc[lane], &src[lane][pos]);
+    }
+
+    for (size_t lane = 0; lane < lanes; lane++)
+    {
+        size_t i = pos;
+
+        for (; i + sizeof(uint64_t) <= sizes[lane]; i += sizeof(uint64_t))
+            crc[lane] = crc32_word(crc[lane], &src[lane][i]);
+
+        for (; i < sizes[lane]; i++)
+            crc[lane] = crc32_byte(crc[lane], src[lane][i]);
+
+        crcs[lane] = crc[lane] ^ UINT32_C(0xFFFFFFFF);
+    }
 }
@@ -2,10 +2,15 @@
 #define CRC32_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 #define CRC32_INIT_VALUE            UINT32_C(0xFFFFFFFF)    ///< Initial value for CRC32 calculation
 #define CRC32_POLYNOME              UINT32_C(0x04C11DB7)    ///< CRC32 polynome to be used for calculating CRC32
+#define CRC32_MAX_LANES             (size_t)UINT8_C(8)      ///< Most buffers crc32_calculate_multi() interleaves
+#define CRC32_PARALLEL_MAX_THREADS  (size_t)UINT8_C(64)     ///< Most threads crc32_calculate_parallel() uses
+#define CRC32_PARALLEL_MIN_SEGMENT  (size_t)UINT32_C(65536) ///< Smallest segment given to a thread
+#define CRC32_LOCATE_MAX_SIZE       (size_t)UINT8_C(255)    ///< Longest data crc32_locate_error() can repair
 
 /**
  * @brief Do the CRC32 for the given data
@@ -18,4 +23,55 @@
  */
 uint32_t crc32_calculate(const char *src, size_t size);
 
+/**
+ * @brief Do the CRC32 of several independent buffers at once
+ *
+ * The buffers are walked in lockstep, so the table lookups of one buffer
+ * overlap with the ones of the others instead of waiting on a single
+ * dependency chain. Meant for many short buffers, such as messages; each
+ * result is the same as crc32_calculate() of the buffer.
+ *
+ * @param[in] srcs The source buffers
+ * @param[in] sizes The size of each buffer of @p srcs
+ * @param[in] count How many buffers there are (at most CRC32_MAX_LANES)
+ * @param[out] crcs The CRC value of each buffer
+ */
+void crc32_calculate_multi(const char * const *srcs, const size_t *sizes, size_t count, uint32_t *crcs);
+
+/**
+ * @brief Find the single flipped bit that explains a CRC mismatch
+ *
+ * A bit flipped in the data changes its CRC by a value (the syndrome) that
+ * only depends on how far the bit is from the end of the data, and a bit
+ * flipped in the received CRC changes it by that bit alone. Every such
+ * syndrome is different up to CRC32_LOCATE_MAX_SIZE bytes of data, so a
+ * table built once maps a syndrome back to its bit in O(1).
+ *
+ * @param[in] size The size of the data the CRC was computed over (at most CRC32_LOCATE_MAX_SIZE)
+ * @param[in] syndrome The CRC computed over the data xored with the CRC received
+ * @param[out] bit Where the flipped bit is: below size * 8, bit (bit % 8) of byte (bit / 8)
+ *                 of the data; otherwise bit (bit - size * 8) of the received CRC
+ *
+ * @retval True if a single flipped bit explains the mismatch; false otherwise
+ */
+bool crc32_locate_error(size_t size, uint32_t syndrome, size_t *bit);
+
+/**
+ * @brief Do the CRC32 of one long buffer on several threads
+ *
+ * The buffer is cut into one segment per thread (none smaller than
+ * CRC32_PARALLEL_MIN_SEGMENT), the calling thread doing the first one.
+ * The segment CRCs are merged in order with zlib's crc32_combine_op()
+ * (crc32_combine64() before zlib 1.2.12), so the result is exactly
+ * crc32_calculate() of the whole buffer done sequentially. A thread that
+ * cannot be started has its segment done by the calling thread.
+ *
+ * @param[in] src The source data to execute the CRC32
+ * @param[in] size The size of @p src buffer
+ * @param[in] threads Most threads to use, calling thread included (at most CRC32_PARALLEL_MAX_THREADS)
+ *
+ * @retval Returns the CRC value
+ */
+uint32_t crc32_calculate_parallel(const char *src, size_t size, size_t threads);
+
 #endif /* CRC32_H__ */
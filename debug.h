@@ -31,16 +31,20 @@
     (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 
 /**
- * The base debug format to use
+ * The base debug format to use; compiled out when DEBUG_SILENT is defined
  * @param[in] file The file stream used
  * @param[in] type String to indicate the debug level to be printed
  * @param[in] format Format used
  * @param[in] ... Variables cited in the format string
  * @return Number of characters printed.
  */
+#ifdef DEBUG_SILENT
+#define __DEBUG__(file, type, format, ...) ((void) 0)
+#else
 #define __DEBUG__(file, type, format, ...) \
     fprintf(file, BOLD type " %s:%d %s()]: " RESET_STYLE format "\n", \
             __DEBUGFILENAME__, __LINE__, __func__, ##__VA_ARGS__)
+#endif /* DEBUG_SILENT */
 
 /**
  * Info print level
@@ -8,101 +8,97 @@
 
 #define ERROR_STRING_SIZE           UINT8_C(255)    ///< The size of error string
 
-error_e g_errno = ERROR_NO_ERROR;            ///< Global application error code
+_Thread_local error_e g_errno = ERROR_NO_ERROR;  ///< Application error code, one per thread
 
-void error_write_error_on_file(const char *filename)
+const char *error_string(error_e error)
 {
-    char error_string[ERROR_STRING_SIZE] = {0};
-    size_t wrote = 0;
-    FILE *fp = NULL;
-
-    if (filename == NULL)
+    switch (error)
     {
+        case ERROR_NO_ERROR:
+            return "No error";
 
-        DEBUG_ERROR("NULL parameter");
-        g_errno = ERROR_NULL_PARAMETER;
-        return;
-    }
-
-    fp = fopen(filename, "w");
-    if (fp == NULL)
-    {
-        DEBUG_ERROR("Creating/opening \"%s\" file", filename);
-        g_errno = ERROR_NOT_OPEN_FILE;
-        return;
-    }
-
-    switch (g_errno)
-    {
         case ERROR_LENGTH:
-            snprintf(error_string, ERROR_STRING_SIZE, "Error in length of the message\n");
-            break;
+            return "Error in length of the message";
 
         case ERROR_CRC:
-            snprintf(error_string, ERROR_STRING_SIZE, "Error in CRC value of the message\n");
-            break;
+            return "Error in CRC value of the message";
 
         case ERROR_NULL_PARAMETER:
-            snprintf(error_string, ERROR_STRING_SIZE, "Error NULL parameter\n");
-            break;
+            return "Error NULL parameter";
 
         case ERROR_FILE_NOT_EXIST:
-            snprintf(error_string, ERROR_STRING_SIZE, "Error file not exist\n");
-            break;
+            return "Error file not exist";
 
         case ERROR_NOT_OPEN_FILE:
-            snprintf(error_string, ERROR_STRING_SIZE, "Error could not open file\n");
-            break;
+            return "Error could not open file";
 
         case ERROR_DATA_NOT_EXPECTED:
-            snprintf(error_string, ERROR_STRING_SIZE, "Data is not expected\n");
-            break;
+            return "Data is not expected";
 
         case ERROR_READING_FILE:
-            snprintf(error_string, ERROR_STRING_SIZE, "Error reading file\n");
-            break;
+            return "Error reading file";
 
         case ERROR_CONVERSION:
-            snprintf(error_string, ERROR_STRING_SIZE, "Error converting string\n");
-            break;
+            return "Error converting string";
 
         case ERROR_BUFFER_SIZE:
-            snprintf(error_string, ERROR_STRING_SIZE, "Error in buffer size\n");
-            break;
+            return "Error in buffer size";
 
         case ERROR_STRING_FORMAT:
-            snprintf(error_string, ERROR_STRING_SIZE, "Error string format\n");
-            break;
+            return "Error string format";
 
         case ERROR_FILE_CREATION:
-            snprintf(error_string, ERROR_STRING_SIZE, "Error file creation\n");
-            break;
+            return "Error file creation";
 
         case ERROR_FTELL:
-            snprintf(error_string, ERROR_STRING_SIZE, "Error calling ftell()\n");
-            break;
+            return "Error calling ftell()";
 
         case ERROR_FSEEK:
-            snprintf(error_string, ERROR_STRING_SIZE, "Error calling fseek()\n");
-            break;
+            return "Error calling fseek()";
 
         case ERROR_INVALID_HEX:
-            snprintf(error_string, ERROR_STRING_SIZE, "The ASCII hex is not an hex");
-            break;
+            return "The ASCII hex is not an hex";
 
         default:
-            snprintf(error_string, ERROR_STRING_SIZE, "Unknown error value: %d\n", g_errno);
-            break;
+            return NULL;
+    }
+}
 
-        case ERROR_NO_ERROR:
-            /* nothing to do */
-            break;
+void error_write_error_on_file(const char *filename)
+{
+    char error_string_buffer[ERROR_STRING_SIZE] = {0};
+    const char *description = NULL;
+    size_t wrote = 0;
+    FILE *fp = NULL;
+
+    if (filename == NULL)
+    {
+
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return;
     }
 
-    wrote = fwrite(error_string, sizeof(char), strlen(error_string), fp);
+    fp = fopen(filename, "w");
+    if (fp == NULL)
+    {
+        DEBUG_ERROR("Creating/opening \"%s\" file", filename);
+        g_errno = ERROR_NOT_OPEN_FILE;
+        return;
+    }
+
+    if (g_errno != ERROR_NO_ERROR)
+    {
+        description = error_string(g_errno);
+        if (description != NULL)
+            snprintf(error_string_buffer, ERROR_STRING_SIZE, "%s\n", description);
+        else
+            snprintf(error_string_buffer, ERROR_STRING_SIZE, "Unknown error value: %d\n", g_errno);
+    }
+
+    wrote = fwrite(error_string_buffer, sizeof(char), strlen(error_string_buffer), fp);
     if (wrote == 0)
         DEBUG_ERROR("Could not write into file \"%s\"", filename);
 
     fclose(fp);
 }
-
@@ -22,7 +22,16 @@ typedef enum error_e {
     ERROR_INVALID_HEX,      ///< The value is not hex
 } error_e;
 
-extern error_e g_errno;     ///< Forward declaration of the global error variable
+extern _Thread_local error_e g_errno;    ///< Forward declaration of the per-thread error variable
+
+/**
+ * @brief Get a human readable description of an error code
+ *
+ * @param[in] error The error code
+ *
+ * @retval Returns a static string; NULL if @p error is not a known code
+ */
+const char *error_string(error_e error);
 
 /**
  * @brief Write the error that happened into the output file
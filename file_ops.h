@@ -33,16 +33,21 @@ bool file_ops_write_output_modified(const char *filename, message_t *message, bo
 bool file_ops_write_output_original(const char *filename, message_t *message, bool append);
 
 /**
- * @brief Function to read from the given file pointer up to the delimiter specified
+ * @brief Map the whole file in memory for reading
  *
- * @param[in] fp The file pointer where it should read
- * @param[out] dst The destination where it sould store the read data
- * @param[in] size The size of @p dst buffer
- * @param[in] delim The delimiter that is the anchor for reading
- * @param[in] inclusive If true, then the @p delim will be included in the dst, if false then @p delim will not be included
+ * @param[in] filename The filename of the file to be mapped
+ * @param[out] size The size of the mapped file
  *
- * @retval Returns the number of bytes read considering that it found the delim. If it does not found the delim, it returns 0 and it fseeks() back to where it started (atomic function)
+ * @retval Returns the mapped bytes (an empty string for an empty file); NULL otherwise
  */
-size_t file_ops_read_until(FILE *fp, char *dst, size_t size, char delim, bool inclusive);
+const char *file_ops_map(const char *filename, size_t *size);
+
+/**
+ * @brief Release a mapping returned by file_ops_map()
+ *
+ * @param[in] data The mapped bytes
+ * @param[in] size The size of the mapped file
+ */
+void file_ops_unmap(const char *data, size_t size);
 
 #endif /* FILE_OPS_H__ */
@@ -0,0 +1,202 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "format.h"
+#include "errors.h"
+#include "utils.h"
+#include "debug.h"
+
+#define FORMAT_TYPE_HEADER          "message type: 0x"                              ///< Header of the type line
+#define FORMAT_LENGTH_HEADER        "initial message length: 0x"                    ///< Header of the original length line
+#define FORMAT_DATA_HEADER          "initial message data bytes: 0x"                ///< Header of the original data line
+#define FORMAT_CRC_HEADER           "initial CRC-32: 0x"                            ///< Header of the original CRC line
+#define FORMAT_MODIFIED_LENGTH_HEADER "modified message length: 0x"                 ///< Header of the modified length line
+#define FORMAT_MODIFIED_DATA_HEADER "modified message data bytes with mask: 0x"     ///< Header of the modified data line
+#define FORMAT_MODIFIED_CRC_HEADER  "modified CRC-32: 0x"                           ///< Header of the modified CRC line
+
+/**
+ * @brief Bytes of every output block that do not depend on the data: headers, new lines and fixed-size payloads
+ *
+ * sizeof() of each header counts its NUL terminator, which stands for the new line ending the line.
+ */
+#define FORMAT_FIXED_SIZE           (size_t)(sizeof(FORMAT_TYPE_HEADER) + \
+                                             sizeof(FORMAT_LENGTH_HEADER) + \
+                                             sizeof(FORMAT_DATA_HEADER) + \
+                                             sizeof(FORMAT_CRC_HEADER) + \
+                                             sizeof(FORMAT_MODIFIED_LENGTH_HEADER) + \
+                                             sizeof(FORMAT_MODIFIED_DATA_HEADER) + \
+                                             sizeof(FORMAT_MODIFIED_CRC_HEADER) + \
+                                             TYPE_HEX_LENGTH + LENGTH_HEX_LENGTH * 2 + CRC32_HEX_LENGTH * 2)
+
+/**
+ * @brief Constant part of an output line, with its size known at compile time
+ */
+typedef struct format_fragment_s {
+    const char *text;       ///< The header text
+    size_t size;            ///< Number of bytes in @p text, without the NUL terminator
+} format_fragment_t;
+
+#define FORMAT_FRAGMENT(text)       { (text), sizeof(text) - 1 }
+
+static const format_fragment_t g_original_template[] = {
+    FORMAT_FRAGMENT(FORMAT_TYPE_HEADER),
+    FORMAT_FRAGMENT(FORMAT_LENGTH_HEADER),
+    FORMAT_FRAGMENT(FORMAT_DATA_HEADER),
+    FORMAT_FRAGMENT(FORMAT_CRC_HEADER),
+};
+
+static const format_fragment_t g_modified_template[] = {
+    FORMAT_FRAGMENT(FORMAT_MODIFIED_LENGTH_HEADER),
+    FORMAT_FRAGMENT(FORMAT_MODIFIED_DATA_HEADER),
+    FORMAT_FRAGMENT(FORMAT_MODIFIED_CRC_HEADER),
+};
+
+static const char g_hex_digits[] = "0123456789abcdef";
+
+size_t format_output_size(uint8_t length)
+{
+    size_t data = 0;
+    size_t append = 0;
+
+    if ((size_t) length <= CRC_SIZE)
+        return 0;
+
+    data = (size_t) length - CRC_SIZE;
+    append = data % ALIGN_APPEND;
+    if ((size_t) length + append > UINT8_MAX)
+        return 0;
+
+    return FORMAT_FIXED_SIZE + (data * 2 + append) * ASCII_HEX_LENGTH;
+}
+
+/**
+ * @brief Write one line of the template: the header, @p src encoded as lower case hex and a new line
+ *
+ * @p dst must have room for the whole line, see format_block().
+ */
+static char *format_line(char *dst, const format_fragment_t *header, const char *src, size_t src_size)
+{
+    memcpy(dst, header->text, header->size);
+    dst += header->size;
+
+    for (size_t i = 0; i < src_size; i++)
+    {
+        *dst++ = g_hex_digits[((uint8_t) src[i]) >> 4];
+        *dst++ = g_hex_digits[((uint8_t) src[i]) & 0x0f];
+    }
+    *dst++ = '\n';
+
+    return dst;
+}
+
+/**
+ * @brief Write the lines of a template, one payload per fragment, after checking that they fit in @p dst
+ */
+static bool format_block(const format_fragment_t *template, const char **payloads,
+                         const size_t *payload_sizes, size_t count,
+                         char *dst, size_t dst_size, size_t *written)
+{
+    size_t required = 0;
+    char *end = dst;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (payload_sizes[i] == 0)
+        {
+            DEBUG_ERROR("Could not convert bin to hex");
+            g_errno = ERROR_CONVERSION;
+            return false;
+        }
+
+        required += template[i].size + payload_sizes[i] * ASCII_HEX_LENGTH + sizeof(char);
+    }
+
+    if (required > dst_size)
+    {
+        DEBUG_ERROR("Destination buffer is smaller than required");
+        g_errno = ERROR_BUFFER_SIZE;
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++)
+        end = format_line(end, &template[i], payloads[i], payload_sizes[i]);
+
+    *written = (size_t)(end - dst);
+
+    return true;
+}
+
+bool format_original(const message_t *message, char *dst, size_t dst_size, size_t *written)
+{
+    const char *payloads[4] = {0};
+    size_t payload_sizes[4] = {0};
+
+    if (message == NULL || dst == NULL || written == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    payloads[0] = &message->type;
+    payload_sizes[0] = sizeof(message->type);
+    payloads[1] = &message->length;
+    payload_sizes[1] = sizeof(message->length);
+    payloads[2] = message->data;
+    payload_sizes[2] = MIN((size_t)(uint8_t) message->length - CRC_SIZE, sizeof(message->data));
+    payloads[3] = message->crc;
+    payload_sizes[3] = sizeof(message->crc);
+
+    return format_block(g_original_template, payloads, payload_sizes,
+                        sizeof(g_original_template) / sizeof(g_original_template[0]),
+                        dst, dst_size, written);
+}
+
+bool format_modified(const message_t *message, char *dst, size_t dst_size, size_t *written)
+{
+    const char *payloads[3] = {0};
+    size_t payload_sizes[3] = {0};
+
+    if (message == NULL || dst == NULL || written == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    payloads[0] = &message->length;
+    payload_sizes[0] = sizeof(message->length);
+    payloads[1] = message->data;
+    payload_sizes[1] = MIN((size_t)(uint8_t) message->length - CRC_SIZE, sizeof(message->data));
+    payloads[2] = message->crc;
+    payload_sizes[2] = sizeof(message->crc);
+
+    return format_block(g_modified_template, payloads, payload_sizes,
+                        sizeof(g_modified_template) / sizeof(g_modified_template[0]),
+                        dst, dst_size, written);
+}
+
+bool format_output_type(const char *src, size_t size, uint8_t *type)
+{
+    const size_t header = sizeof(FORMAT_TYPE_HEADER) - 1;
+    char value = 0;
+
+    if (src == NULL || type == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    if (size < header + TYPE_HEX_LENGTH || memcmp(src, FORMAT_TYPE_HEADER, header) != 0 ||
+        utils_hex_to_bin(&src[header], TYPE_HEX_LENGTH, &value, sizeof(value)) != sizeof(value))
+    {
+        DEBUG_ERROR("Not an output block");
+        g_errno = ERROR_STRING_FORMAT;
+        return false;
+    }
+
+    *type = (uint8_t) value;
+
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef FORMAT_H__
+#define FORMAT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "message.h"
+
+#define FORMAT_BLOCK_MAX_SIZE       (size_t)UINT16_C(1024)  ///< Upper bound of one formatted block (original or modified)
+
+/**
+ * @brief Compute the size of the output (original and modified blocks) of a message from its length alone
+ *
+ * @param[in] length The length field of the original message
+ *
+ * @retval Returns the size in bytes; 0 if the length is not valid
+ */
+size_t format_output_size(uint8_t length);
+
+/**
+ * @brief Format the original message block into the given buffer
+ *
+ * @param[in] message The message structure where should get the data
+ * @param[out] dst The destination where the formatted block will be stored
+ * @param[in] dst_size The size of @p dst buffer
+ * @param[out] written How many bytes were written into @p dst
+ *
+ * @retval True if success; false otherwise
+ */
+bool format_original(const message_t *message, char *dst, size_t dst_size, size_t *written);
+
+/**
+ * @brief Format the modified message block into the given buffer
+ *
+ * @param[in] message The message structure where should get the data
+ * @param[out] dst The destination where the formatted block will be stored
+ * @param[in] dst_size The size of @p dst buffer
+ * @param[out] written How many bytes were written into @p dst
+ *
+ * @retval True if success; false otherwise
+ */
+bool format_modified(const message_t *message, char *dst, size_t dst_size, size_t *written);
+
+/**
+ * @brief Read the message type back from the first line of an output block
+ *
+ * @param[in] src The output block
+ * @param[in] size The size of @p src buffer
+ * @param[out] type The message type
+ *
+ * @retval True if success; false if @p src does not start with a type line
+ */
+bool format_output_type(const char *src, size_t size, uint8_t *type);
+
+#endif /* FORMAT_H__ */
@@ -0,0 +1,206 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <signal.h>
+
+#include "ingest.h"
+#include "ring.h"
+#include "auriga.h"
+#include "cache.h"
+#include "affinity.h"
+#include "utils.h"
+#include "errors.h"
+#include "debug.h"
+
+/**
+ * @brief State of the processor side of the rings
+ */
+typedef struct ingest_s {
+    ring_t ring;                                    ///< The shared memory object
+    cache_t *cache;                                 ///< Cache of output blocks (may be NULL)
+    bool busy_poll;                                 ///< Spin on the rings instead of sleeping on them
+    uint32_t flags;                                 ///< AURIGA_FLAG_* bits the records are processed with
+    auriga_span_t spans[INGEST_BATCH_SIZE];         ///< Records of the batch, pointing into the request slots
+    auriga_result_t results[INGEST_BATCH_SIZE];     ///< Outcome of each record of the batch
+    char *output;                                   ///< Output blocks of the batch, before they are copied into the response slots
+    uint64_t requests;                              ///< Records answered
+    uint64_t failures;                              ///< Records answered with an error
+    uint64_t batches;                               ///< Batches processed
+} ingest_t;
+
+static volatile sig_atomic_t g_ingest_stop = 0;    ///< Set by SIGINT and SIGTERM
+
+static void ingest_on_signal(int signal_number)
+{
+    (void) signal_number;
+    g_ingest_stop = 1;
+}
+
+static void ingest_process(ingest_t *ingest, size_t count)
+{
+    ring_shared_t *shared = ingest->ring.shared;
+    uint64_t tail = atomic_load_explicit(&shared->requests.tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&shared->responses.head, memory_order_relaxed);
+    const ring_request_t *request = NULL;
+    ring_response_t *response = NULL;
+    const size_t mask = ingest->ring.slots - 1;
+
+    /* the records are parsed where the producer wrote them */
+    for (size_t i = 0; i < count; i++)
+    {
+        request = &ingest->ring.requests[(tail + i) & mask];
+        ingest->spans[i].data = request->data;
+        ingest->spans[i].size = MIN((size_t) request->size, RING_REQUEST_SIZE);
+    }
+
+    auriga_process_batch(ingest->spans, count, ingest->flags, ingest->cache,
+                         ingest->output, count * AURIGA_OUTPUT_MAX_SIZE, ingest->results);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        request = &ingest->ring.requests[(tail + i) & mask];
+        response = &ingest->ring.responses[(head + i) & mask];
+
+        response->id = request->id;
+        response->error = (uint32_t) ingest->results[i].error;
+        response->flags = (ingest->results[i].corrected == true) ? RING_FLAG_CORRECTED : 0;
+        response->size = 0;
+        if (ingest->results[i].error == ERROR_NO_ERROR)
+        {
+            memcpy(response->data, &ingest->output[ingest->results[i].offset], ingest->results[i].size);
+            response->size = (uint32_t) ingest->results[i].size;
+        }
+        else
+        {
+            ingest->failures++;
+        }
+    }
+
+    /* responses first: a producer taking over a dead one's rings waits for the requests to be released, see ring_attach() */
+    ring_publish(&shared->responses, count);
+    ring_release(&shared->requests, count);
+
+    ingest->requests += count;
+    ingest->batches++;
+}
+
+static void ingest_loop(ingest_t *ingest)
+{
+    ring_shared_t *shared = ingest->ring.shared;
+    uint32_t doorbell = 0;
+    size_t readable = 0;
+    size_t writable = 0;
+
+    while (g_ingest_stop == 0)
+    {
+        readable = ring_readable(&shared->requests);
+        writable = ring_writable(&shared->responses, ingest->ring.slots);
+
+        if (readable != 0 && writable != 0)
+        {
+            ingest_process(ingest, MIN(MIN(readable, writable), INGEST_BATCH_SIZE));
+            continue;
+        }
+
+        if (ingest->busy_poll == true)
+            continue;
+
+        /* nothing to read, or the producer has not taken its responses yet */
+        if (readable == 0)
+        {
+            doorbell = ring_doorbell(&shared->requests);
+            if (ring_readable(&shared->requests) == 0)
+                ring_wait(&shared->requests, doorbell, INGEST_SLEEP_MS);
+        }
+        else
+        {
+            doorbell = ring_doorbell(&shared->responses);
+            if (ring_writable(&shared->responses, ingest->ring.slots) == 0)
+                ring_wait(&shared->responses, doorbell, INGEST_SLEEP_MS);
+        }
+    }
+}
+
+bool ingest_run(const options_t *options)
+{
+    struct sigaction action;
+    cache_stats_t stats;
+    ingest_t *ingest = NULL;
+    int cpu = AFFINITY_NONE;
+
+    if (options == NULL || options->ring == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    cpu = affinity_cpu(&options->worker_cpus, 0);
+    if (affinity_pin_self(cpu) == false)
+        return false;
+    if (options->numa == true && affinity_prefer_node(affinity_node(cpu)) == false)
+        DEBUG_WARN("The processor buffers are not placed on the node of CPU %d", cpu);
+
+    ingest = calloc(1, sizeof(*ingest));
+    if (ingest != NULL)
+        ingest->output = malloc(INGEST_BATCH_SIZE * AURIGA_OUTPUT_MAX_SIZE);
+    if (ingest == NULL || ingest->output == NULL)
+    {
+        DEBUG_ERROR("Could not allocate the processor buffers");
+        if (ingest != NULL)
+            free(ingest);
+        g_errno = ERROR_BUFFER_SIZE;
+        return false;
+    }
+    ingest->busy_poll = options->busy_poll;
+    ingest->flags = (options->correct == true) ? AURIGA_FLAG_CORRECT_CRC : 0;
+
+    if (options->cache_entries != 0)
+    {
+        ingest->cache = cache_create(options->cache_entries);
+        if (ingest->cache == NULL)
+        {
+            free(ingest->output);
+            free(ingest);
+            g_errno = ERROR_BUFFER_SIZE;
+            return false;
+        }
+    }
+
+    if (ring_create(&ingest->ring, options->ring, options->ring_slots) == false)
+    {
+        cache_destroy(ingest->cache);
+        free(ingest->output);
+        free(ingest);
+        return false;
+    }
+
+    /* no SA_RESTART, so that a processor sleeping on the futex wakes up at once */
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = ingest_on_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    DEBUG_INFO("Processing records pushed on \"%s\" (%zu slots per ring)%s", options->ring,
+               ingest->ring.slots, (options->busy_poll == true) ? ", busy polling" : "");
+
+    ingest_loop(ingest);
+
+    DEBUG_INFO("Answered %" PRIu64 " records (%" PRIu64 " failed) in %" PRIu64 " batches",
+               ingest->requests, ingest->failures, ingest->batches);
+    if (ingest->cache != NULL)
+    {
+        cache_get_stats(ingest->cache, &stats);
+        DEBUG_INFO("Cache: %" PRIu64 " hits, %" PRIu64 " misses", stats.hits, stats.misses);
+    }
+
+    ring_detach(&ingest->ring);
+    cache_destroy(ingest->cache);
+    free(ingest->output);
+    free(ingest);
+
+    return true;
+}
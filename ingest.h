@@ -0,0 +1,30 @@
+#ifndef INGEST_H__
+#define INGEST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "options.h"
+
+#define INGEST_BATCH_SIZE           (size_t)UINT16_C(64)    ///< Requests processed in one call
+#define INGEST_SLEEP_MS             (int)(100)              ///< Longest sleep on an idle ring, so that a stop request is noticed
+
+/**
+ * @brief Answer records pushed by a producer on the same host through shared memory, until SIGINT or SIGTERM
+ *
+ * A shared memory object holding a request ring and a response ring of
+ * fixed size slots is created under the given name (see ring.h). The
+ * producer pushes one record per request slot. The processor takes the
+ * requests waiting (up to INGEST_BATCH_SIZE, and no more than there are
+ * free response slots), processes them as one batch straight from their
+ * slots, and pushes one response per request, in order: the output block,
+ * or nothing and the error code. Both sides sleep on a futex when there
+ * is nothing to do; with busy polling the processor spins instead.
+ *
+ * @param[in] options The application options (ring name and slots, cache, ...)
+ *
+ * @retval True if the processor was stopped by a signal; false if it could not run
+ */
+bool ingest_run(const options_t *options);
+
+#endif /* INGEST_H__ */
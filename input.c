@@ -0,0 +1,365 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "input.h"
+#include "file_ops.h"
+#include "utils.h"
+#include "debug.h"
+
+static const unsigned char g_gzip_magic[] = { 0x1f, 0x8b };              ///< First bytes of a gzip member
+static const unsigned char g_zstd_magic[] = { 0x28, 0xb5, 0x2f, 0xfd };  ///< First bytes of a zstd frame
+
+static void input_fail(input_t *input, error_e error)
+{
+    pthread_mutex_lock(&input->lock);
+    input->error = error;
+    input->writing = false;
+    input->eof = true;
+    pthread_cond_broadcast(&input->changed);
+    pthread_mutex_unlock(&input->lock);
+}
+
+static void *input_inflate(void *argument)
+{
+    input_t *input = argument;
+    unsigned char *compressed = NULL;
+    size_t room = 0;
+    size_t produced = 0;
+    bool done = false;
+    char *dst = NULL;
+    int status = Z_OK;
+
+    if (affinity_prefer_node(input->node) == false)
+        DEBUG_WARN("The input window is not placed on node %d", input->node);
+
+    compressed = malloc(INPUT_STREAM_READ);
+    if (compressed == NULL)
+    {
+        input_fail(input, ERROR_BUFFER_SIZE);
+        return NULL;
+    }
+
+    while (done == false)
+    {
+        pthread_mutex_lock(&input->lock);
+        while (input->stop == false && INPUT_STREAM_SIZE - input->ready < INPUT_STREAM_CHUNK)
+        {
+            input->writing = false;
+            pthread_cond_broadcast(&input->changed);
+            pthread_cond_wait(&input->changed, &input->lock);
+        }
+
+        if (input->stop == true)
+        {
+            input->writing = false;
+            pthread_mutex_unlock(&input->lock);
+            break;
+        }
+
+        input->writing = true;
+        dst = &input->buffer[input->ready];
+        room = INPUT_STREAM_CHUNK;
+        pthread_mutex_unlock(&input->lock);
+
+        input->stream.next_out = (Bytef *) dst;
+        input->stream.avail_out = (uInt) room;
+
+        while (input->stream.avail_out != 0)
+        {
+            if (input->stream.avail_in == 0)
+            {
+                input->stream.avail_in = (uInt) fread(compressed, sizeof(char), INPUT_STREAM_READ, input->fp);
+                input->stream.next_in = compressed;
+                if (input->stream.avail_in == 0)
+                {
+                    if (ferror(input->fp) != 0 || status != Z_STREAM_END)
+                    {
+                        DEBUG_ERROR("File \"%s\" is truncated or unreadable", input->filename);
+                        free(compressed);
+                        input_fail(input, ERROR_READING_FILE);
+                        return NULL;
+                    }
+
+                    done = true;
+                    break;
+                }
+            }
+
+            /* concatenated gzip members (e.g. from parallel compressors) form one stream */
+            if (status == Z_STREAM_END)
+                inflateReset(&input->stream);
+
+            status = inflate(&input->stream, Z_NO_FLUSH);
+            if (status != Z_OK && status != Z_STREAM_END)
+            {
+                DEBUG_ERROR("Could not inflate \"%s\": %s", input->filename,
+                            input->stream.msg != NULL ? input->stream.msg : "unknown error");
+                free(compressed);
+                input_fail(input, ERROR_CONVERSION);
+                return NULL;
+            }
+        }
+
+        produced = room - input->stream.avail_out;
+
+        pthread_mutex_lock(&input->lock);
+        input->ready += produced;
+        input->writing = false;
+        input->eof = done;
+        pthread_cond_broadcast(&input->changed);
+        pthread_mutex_unlock(&input->lock);
+    }
+
+    free(compressed);
+
+    return NULL;
+}
+
+static bool input_open_gzip(input_t *input)
+{
+    pthread_attr_t attr;
+    int error = 0;
+
+    input->fp = fopen(input->filename, "rb");
+    if (input->fp == NULL)
+    {
+        DEBUG_ERROR("Could not open file \"%s\"", input->filename);
+        g_errno = ERROR_NOT_OPEN_FILE;
+        return false;
+    }
+
+    input->buffer = malloc(INPUT_STREAM_SIZE);
+    if (input->buffer == NULL)
+    {
+        DEBUG_ERROR("Could not allocate the input window");
+        g_errno = ERROR_BUFFER_SIZE;
+        return false;
+    }
+
+    /* 15 + 32: largest window, gzip or zlib header detected automatically */
+    if (inflateInit2(&input->stream, 15 + 32) != Z_OK)
+    {
+        DEBUG_ERROR("Could not initialize zlib");
+        g_errno = ERROR_CONVERSION;
+        return false;
+    }
+
+    pthread_mutex_init(&input->lock, NULL);
+    pthread_cond_init(&input->changed, NULL);
+
+    pthread_attr_init(&attr);
+    if (affinity_set_attr(&attr, input->cpu) == false)
+    {
+        pthread_attr_destroy(&attr);
+        return false;
+    }
+
+    error = pthread_create(&input->thread, &attr, input_inflate, input);
+    pthread_attr_destroy(&attr);
+    if (error != 0)
+    {
+        DEBUG_ERROR("Could not start the inflating thread");
+        g_errno = ERROR_BUFFER_SIZE;
+        return false;
+    }
+
+    return true;
+}
+
+bool input_open(input_t *input, const char *filename, int cpu, int node)
+{
+    unsigned char magic[sizeof(g_zstd_magic)] = {0};
+    struct stat st;
+    size_t read = 0;
+    FILE *fp = NULL;
+
+    if (input == NULL || filename == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    memset(input, 0, sizeof(*input));
+    input->filename = filename;
+    input->cpu = cpu;
+    input->node = node;
+
+    if (stat(filename, &st) != 0)
+    {
+        DEBUG_ERROR("File \"%s\" does not exist", filename);
+        g_errno = ERROR_FILE_NOT_EXIST;
+        return false;
+    }
+    input->file_size = (size_t) st.st_size;
+
+    fp = fopen(filename, "rb");
+    if (fp == NULL)
+    {
+        DEBUG_ERROR("Could not open file \"%s\"", filename);
+        g_errno = ERROR_NOT_OPEN_FILE;
+        return false;
+    }
+    read = fread(magic, sizeof(char), sizeof(magic), fp);
+    fclose(fp);
+
+    if (read >= sizeof(g_zstd_magic) && memcmp(magic, g_zstd_magic, sizeof(g_zstd_magic)) == 0)
+    {
+        DEBUG_ERROR("File \"%s\" is zstd compressed, which this build does not support", filename);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    if (read >= sizeof(g_gzip_magic) && memcmp(magic, g_gzip_magic, sizeof(g_gzip_magic)) == 0)
+    {
+        input->mode = INPUT_MODE_GZIP;
+        if (input_open_gzip(input) == true)
+            return true;
+
+        input_close(input);
+        return false;
+    }
+
+    input->mode = INPUT_MODE_MMAP;
+    input->data = file_ops_map(filename, &input->file_size);
+
+    return (input->data != NULL);
+}
+
+bool input_window(input_t *input, const char **data, size_t *size, bool *final)
+{
+    const size_t wanted = INPUT_STREAM_SIZE / 4;
+    error_e error = ERROR_NO_ERROR;
+
+    if (input == NULL || data == NULL || size == NULL || final == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    switch (input->mode)
+    {
+        case INPUT_MODE_MMAP:
+            *data = &input->data[input->offset];
+            *size = input->file_size - input->offset;
+            *final = true;
+            return true;
+
+        case INPUT_MODE_GZIP:
+            break;
+
+        default:
+            DEBUG_ERROR("Unknown input mode %d", input->mode);
+            g_errno = ERROR_DATA_NOT_EXPECTED;
+            return false;
+    }
+
+    pthread_mutex_lock(&input->lock);
+
+    /* move the unconsumed tail to the front once the window runs out of room */
+    if (input->start > INPUT_STREAM_SIZE / 2 || INPUT_STREAM_SIZE - input->ready < INPUT_STREAM_CHUNK)
+    {
+        while (input->writing == true)
+            pthread_cond_wait(&input->changed, &input->lock);
+
+        memmove(input->buffer, &input->buffer[input->start], input->ready - input->start);
+        input->ready -= input->start;
+        input->start = 0;
+        pthread_cond_broadcast(&input->changed);
+    }
+
+    while (input->eof == false && input->ready - input->start < wanted)
+        pthread_cond_wait(&input->changed, &input->lock);
+
+    *data = &input->buffer[input->start];
+    *size = input->ready - input->start;
+    *final = input->eof;
+    /* set by the inflating thread, under the lock */
+    error = input->error;
+
+    pthread_mutex_unlock(&input->lock);
+
+    if (error != ERROR_NO_ERROR)
+    {
+        g_errno = error;
+        return false;
+    }
+
+    return true;
+}
+
+void input_consume(input_t *input, size_t size)
+{
+    if (input == NULL)
+        return;
+
+    input->offset += size;
+
+    if (input->mode != INPUT_MODE_GZIP)
+        return;
+
+    pthread_mutex_lock(&input->lock);
+    input->start += size;
+    pthread_mutex_unlock(&input->lock);
+}
+
+bool input_skip(input_t *input, size_t offset)
+{
+    const char *data = NULL;
+    size_t size = 0;
+    bool final = false;
+
+    while (input->offset < offset)
+    {
+        if (input_window(input, &data, &size, &final) == false)
+            return false;
+
+        if (size == 0)
+        {
+            DEBUG_ERROR("Input is shorter than %zu bytes", offset);
+            g_errno = ERROR_DATA_NOT_EXPECTED;
+            return false;
+        }
+
+        input_consume(input, MIN(size, offset - input->offset));
+    }
+
+    return true;
+}
+
+void input_close(input_t *input)
+{
+    if (input == NULL)
+        return;
+
+    switch (input->mode)
+    {
+        case INPUT_MODE_MMAP:
+            file_ops_unmap(input->data, input->file_size);
+            break;
+
+        case INPUT_MODE_GZIP:
+            if (input->thread != 0)
+            {
+                pthread_mutex_lock(&input->lock);
+                input->stop = true;
+                pthread_cond_broadcast(&input->changed);
+                pthread_mutex_unlock(&input->lock);
+                pthread_join(input->thread, NULL);
+                pthread_cond_destroy(&input->changed);
+                pthread_mutex_destroy(&input->lock);
+            }
+            inflateEnd(&input->stream);
+            if (input->fp != NULL)
+                fclose(input->fp);
+            free(input->buffer);
+            break;
+
+        default:
+            break;
+    }
+
+    memset(input, 0, sizeof(*input));
+}
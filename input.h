@@ -0,0 +1,103 @@
+#ifndef INPUT_H__
+#define INPUT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#include "errors.h"
+#include "affinity.h"
+
+#define INPUT_STREAM_SIZE           (size_t)UINT32_C(67108864)  ///< Window of decompressed input kept in memory
+#define INPUT_STREAM_CHUNK          (size_t)UINT32_C(1048576)   ///< Bytes inflated between two hand-overs to the parser
+#define INPUT_STREAM_READ           (size_t)UINT32_C(262144)    ///< Compressed bytes read at once
+
+/**
+ * @brief How the input bytes are made available to the parser
+ */
+typedef enum input_mode_e {
+    INPUT_MODE_MMAP,        ///< Plain file, mapped as a whole
+    INPUT_MODE_GZIP,        ///< gzip file, inflated on the fly by a separate thread
+} input_mode_e;
+
+/**
+ * @brief Input file read through a sliding window
+ */
+typedef struct input_s {
+    input_mode_e mode;          ///< How the bytes are made available
+    const char *filename;       ///< The input file
+    size_t file_size;           ///< Size of the file on disk
+    size_t offset;              ///< Input bytes consumed so far (decompressed)
+    const char *data;           ///< Mapped file (INPUT_MODE_MMAP)
+    char *buffer;               ///< Decompressed window (INPUT_MODE_GZIP)
+    size_t start;               ///< First byte of @p buffer not yet consumed
+    size_t ready;               ///< One past the last byte of @p buffer inflated so far
+    bool writing;               ///< The inflating thread is writing past @p ready
+    bool eof;                   ///< Everything has been inflated
+    bool stop;                  ///< Ask the inflating thread to stop
+    error_e error;              ///< Why the inflating thread stopped, if it failed
+    FILE *fp;                   ///< Compressed file
+    z_stream stream;            ///< zlib state
+    pthread_t thread;           ///< Inflating thread
+    int cpu;                    ///< CPU the inflating thread is pinned to (AFFINITY_NONE if not pinned)
+    int node;                   ///< NUMA node the inflating thread allocates from (AFFINITY_NONE if any)
+    pthread_mutex_t lock;       ///< Protects the window bounds and flags
+    pthread_cond_t changed;     ///< Signalled whenever the window bounds or flags change
+} input_t;
+
+/**
+ * @brief Open the input file, detecting compressed input by its magic bytes
+ *
+ * @param[out] input The input to be initialized
+ * @param[in] filename The input file
+ * @param[in] cpu CPU the inflating thread is pinned to; AFFINITY_NONE to leave it unpinned
+ * @param[in] node NUMA node the decompressed window is placed on; AFFINITY_NONE for any
+ *
+ * @retval True if success; false otherwise
+ */
+bool input_open(input_t *input, const char *filename, int cpu, int node);
+
+/**
+ * @brief Get the bytes available after the consumed ones
+ *
+ * For compressed input this blocks until a large enough window is
+ * available (or the whole input was inflated).
+ *
+ * @param[in,out] input The input
+ * @param[out] data The first available byte
+ * @param[out] size How many bytes are available
+ * @param[out] final True if nothing follows the available bytes
+ *
+ * @retval True if success; false otherwise
+ */
+bool input_window(input_t *input, const char **data, size_t *size, bool *final);
+
+/**
+ * @brief Mark the first @p size available bytes as processed
+ *
+ * @param[in,out] input The input
+ * @param[in] size How many bytes were processed
+ */
+void input_consume(input_t *input, size_t size);
+
+/**
+ * @brief Discard the first @p offset bytes of the input (resume)
+ *
+ * @param[in,out] input The input
+ * @param[in] offset How many bytes to discard
+ *
+ * @retval True if success; false if the input is shorter
+ */
+bool input_skip(input_t *input, size_t offset);
+
+/**
+ * @brief Stop reading and release the input
+ *
+ * @param[in,out] input The input
+ */
+void input_close(input_t *input);
+
+#endif /* INPUT_H__ */
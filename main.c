@@ -1,35 +1,78 @@
 #include "errors.h"
 #include "message.h"
 #include "file_ops.h"
+#include "options.h"
+#include "batch.h"
+#include "server.h"
+#include "ingest.h"
 #include "debug.h"
 
-#define INPUT_FILE      ("data_in.txt")     ///< Input file to be used
-#define OUTPUT_FILE     ("data_out.txt")    ///< Output file to be written to
-
 int main(int argc, char **argv)
 {
     message_t original_message;
     message_t modified_message;
+    options_t options;
+
+    if (options_parse(argc, argv, &options) == false)
+        return g_errno;
+
+    if (options.socket != NULL)
+    {
+        if (server_run(&options) == false)
+            return g_errno;
+
+        DEBUG_INFO("Execution completed");
+
+        return 0;
+    }
+
+    if (options.ring != NULL)
+    {
+        if (ingest_run(&options) == false)
+            return g_errno;
 
-    (void) argc;
-    (void) argv;
+        DEBUG_INFO("Execution completed");
 
-    if (message_load(INPUT_FILE, &original_message) == false)
+        return 0;
+    }
+
+    if (options.batch == true)
+    {
+        if (batch_run(&options) == false)
+        {
+            /* the output of a checkpointed run holds the progress a resume picks up: keep it */
+            if (options.checkpoint != NULL)
+            {
+                DEBUG_ERROR("Run stopped: %s; \"%s\" was left as is", error_string(g_errno), options.output);
+                return g_errno;
+            }
+
+            DEBUG_WARN("Please check \"%s\" file for error message\n", options.output);
+            error_write_error_on_file(options.output);
+
+            return g_errno;
+        }
+
+        DEBUG_INFO("Execution completed");
+
+        return 0;
+    }
+
+    if (message_load(options.input, options.correct, &original_message) == false)
     {
-        DEBUG_WARN("Please check \"%s\" file for error message\n", OUTPUT_FILE);
-        error_write_error_on_file(OUTPUT_FILE);
+        DEBUG_WARN("Please check \"%s\" file for error message\n", options.output);
+        error_write_error_on_file(options.output);
 
         return g_errno;
     }
 
     message_update(&original_message, &modified_message);
-    file_ops_write_output_original(OUTPUT_FILE, &original_message, FILE_OPS_APPEND);
+    file_ops_write_output_original(options.output, &original_message, FILE_OPS_APPEND);
 
     if (g_errno == ERROR_NO_ERROR)
-        file_ops_write_output_modified(OUTPUT_FILE, &modified_message, FILE_OPS_APPEND);
+        file_ops_write_output_modified(options.output, &modified_message, FILE_OPS_APPEND);
 
     DEBUG_INFO("Execution completed");
 
     return 0;
 }
-
@@ -1,23 +1,22 @@
 #include <arpa/inet.h>
 #include <string.h>
-#include <stdio.h>
 #include <unistd.h>
 #include <stdlib.h>
 
 #include "message.h"
 #include "errors.h"
 #include "file_ops.h"
+#include "record.h"
 #include "utils.h"
 #include "crc32.h"
+#include "trace.h"
 #include "debug.h"
 
-bool message_load(const char *filename, message_t *message)
+bool message_load(const char *filename, bool correct, message_t *message)
 {
-    char ascii_byte[ASCII_HEX_LENGTH + 1] = {0};
-    char keyword_message[g_message_leading_length + 1];
-    char keyword_mask[g_mask_leading_length + 1];
-    FILE *fp = NULL;
+    const char *input = NULL;
     size_t size = 0;
+    bool success = false;
 
     if (filename == NULL || message == NULL)
     {
@@ -33,135 +32,239 @@ bool message_load(const char *filename, message_t *message)
         return false;
     }
 
-    fp = fopen(filename, "r");
-    if (fp == NULL)
-    {
-        DEBUG_ERROR("Could not open file \"%s\"", filename);
-        g_errno = ERROR_NOT_OPEN_FILE;
+    input = file_ops_map(filename, &size);
+    if (input == NULL)
         return false;
-    }
 
-    size = file_ops_read_until(fp, keyword_message, sizeof(keyword_message), '=', DELIMITER_INCLUSIVE);
-    if (size != sizeof(g_message_leading_keyword) - 1)
-    {
-        DEBUG_ERROR("Read data different from expected");
-        fclose(fp);
-        g_errno = ERROR_DATA_NOT_EXPECTED;
+    success = message_parse(input, size, correct, message, NULL);
+
+    file_ops_unmap(input, size);
+
+    return success;
+}
+
+/**
+ * @brief Flip back the single bit that explains a CRC mismatch, if there is one
+ */
+static bool message_correct(message_t *message, uint32_t calculated, uint32_t received)
+{
+    size_t size = (size_t)(uint8_t) message->length - CRC_SIZE;
+    size_t bit = 0;
+
+    if (crc32_locate_error(size, calculated ^ received, &bit) == false)
         return false;
+
+    if (bit < size * 8)
+    {
+        message->data[bit / 8] ^= (char)(1u << (bit % 8));
+        if (crc32_calculate(message->data, size) != received)
+        {
+            message->data[bit / 8] ^= (char)(1u << (bit % 8));
+            return false;
+        }
+
+        DEBUG_WARN("Corrected bit %zu of data byte %zu", bit % 8, bit / 8);
+    }
+    else
+    {
+        received = htonl(calculated);
+        memcpy(message->crc, &received, sizeof(received));
+
+        DEBUG_WARN("Corrected bit %zu of the CRC", bit - size * 8);
     }
 
-    if (strncmp(keyword_message, g_message_leading_keyword,
-                MAX(strlen(keyword_message), strlen(g_message_leading_keyword))) != 0)
+    message->corrected = true;
+
+    return true;
+}
+
+static bool message_check_crc(message_t *message, uint32_t calculated, bool correct)
+{
+    uint32_t received = 0;
+
+    memcpy(&received, message->crc, sizeof(received));
+    if (ntohl(received) != calculated &&
+        (correct == false || message_correct(message, calculated, ntohl(received)) == false))
     {
-        DEBUG_ERROR("Could not find anchor \"%s\" on the file", g_message_leading_keyword);
-        fclose(fp);
-        g_errno = ERROR_DATA_NOT_EXPECTED;
+        DEBUG_ERROR("Wrong CRC, should be=%08x, got=%08x", calculated, ntohl(received));
+        g_errno = ERROR_CRC;
         return false;
     }
 
-    size = fread(ascii_byte, sizeof(uint8_t), MIN(ASCII_HEX_LENGTH, sizeof(ascii_byte)), fp);
-    if (size != ASCII_HEX_LENGTH)
+    return true;
+}
+
+static bool message_decode(message_t *message)
+{
+    size_t pos = (size_t)(uint8_t) message->length * ASCII_HEX_LENGTH - CRC32_HEX_LENGTH;
+
+    if (utils_hex_to_bin(message->message.raw, pos, message->data, sizeof(message->data)) == false)
     {
-        DEBUG_ERROR("Could not read correctly");
-        fclose(fp);
-        g_errno = ERROR_DATA_NOT_EXPECTED;
+        DEBUG_ERROR("Could not convert hex to bin");
+        g_errno = ERROR_CONVERSION;
         return false;
     }
-    message->type = (char)(0xff & strtoul(ascii_byte, NULL, 16));
 
-    size = fread(ascii_byte, sizeof(uint8_t), MIN(ASCII_HEX_LENGTH, sizeof(ascii_byte)), fp);
-    if (size != ASCII_HEX_LENGTH)
+    if (utils_hex_to_bin(&message->message.raw[pos], CRC32_HEX_LENGTH,
+                         message->crc, sizeof(message->crc)) == false)
     {
-        DEBUG_ERROR("Could not read correctly");
-        fclose(fp);
-        g_errno = ERROR_READING_FILE;
+        DEBUG_ERROR("Could not convert hex to bin");
+        g_errno = ERROR_CONVERSION;
         return false;
     }
-    message->length = (char)(0xff & strtoul(ascii_byte, NULL, 16));
 
-    message->message.size = file_ops_read_until(fp, message->message.raw,
-                                       sizeof(message->message.raw),
-                                       '\n', DELIMITER_EXCLUSIVE);
-    if (message->message.size != ((size_t) message->length * ASCII_HEX_LENGTH))
+    if (utils_hex_to_bin(message->mask.raw, message->mask.size, message->mask_val, sizeof(message->mask_val)) == false)
     {
-        DEBUG_ERROR("Wrong message size");
-        g_errno = ERROR_LENGTH;
+        DEBUG_ERROR("Could not convert hex to bin");
+        g_errno = ERROR_CONVERSION;
         return false;
     }
 
-    size = file_ops_read_until(fp, keyword_mask, sizeof(keyword_mask), '=', DELIMITER_INCLUSIVE);
-    if (size != sizeof(keyword_mask) - 1)
+    return true;
+}
+
+/**
+ * @brief Record a stage done together for several lanes of a batch
+ *
+ * A failed lane, or a record answered from the cache, leaves a gap between
+ * the records of the lanes; a range event would then name the wrong ones,
+ * so each lane gets its own event.
+ */
+static void message_trace_lanes(trace_stage_e stage, uint64_t begin, const size_t *lanes, size_t count)
+{
+    if (g_trace_ring == NULL || count == 0)
+        return;
+
+    /* the records of the lanes are increasing, so this only holds when they are consecutive */
+    if (TRACE_LANE(lanes[count - 1]) - TRACE_LANE(lanes[0]) == (uint64_t)(count - 1))
     {
-        DEBUG_ERROR("Read data different from expected");
-        fclose(fp);
-        g_errno = ERROR_DATA_NOT_EXPECTED;
-        return false;
+        trace_record(stage, begin, TRACE_LANE(lanes[0]), count);
+        return;
     }
 
-    if (strncmp(keyword_mask, g_mask_leading_keyword,
-                MAX(strlen(keyword_mask), strlen(g_mask_leading_keyword))) != 0)
+    for (size_t i = 0; i < count; i++)
+        trace_record(stage, begin, TRACE_LANE(lanes[i]), 1);
+}
+
+/**
+ * @brief Parse and decode a record, leaving the CRC check to the caller
+ */
+static bool message_parse_record(const char *src, size_t size, message_t *message, size_t *consumed)
+{
+    char header[TYPE_SIZE + LENGTH_SIZE] = {0};
+    record_token_t token;
+    size_t payload_size = 0;
+
+    if (src == NULL || message == NULL)
     {
-        DEBUG_ERROR("Error! Could not find anchor \"%s\" on the file", filename);
-        fclose(fp);
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
         return false;
     }
 
-    message->mask.size = file_ops_read_until(fp, message->mask.raw, sizeof(message->mask.raw), '\n', DELIMITER_EXCLUSIVE);
-    if (message->mask.size != MASK_HEX_LENGTH)
+    if (record_scan(src, size, true, &token) == false)
     {
-        DEBUG_ERROR("Wrong message size");
-        g_errno = ERROR_LENGTH;
+        DEBUG_ERROR("Invalid record at byte %zu: %s", token.offset, record_error_string(token.error));
+        g_errno = record_error_code(token.error);
         return false;
     }
 
-    if (utils_hex_to_bin(message->message.raw, (size_t) message->length * ASCII_HEX_LENGTH - CRC32_HEX_LENGTH,
-                         message->data, sizeof(message->data)) == false)
+    if (utils_hex_to_bin(token.message, TYPE_HEX_LENGTH + LENGTH_HEX_LENGTH, header, sizeof(header)) == false)
     {
         DEBUG_ERROR("Could not convert hex to bin");
-        fclose(fp);
         g_errno = ERROR_CONVERSION;
         return false;
     }
+    message->type = header[0];
+    message->length = header[1];
+    message->corrected = false;
 
-    size_t pos = (size_t) message->length * ASCII_HEX_LENGTH - CRC32_HEX_LENGTH;
-
-    if (utils_hex_to_bin(&message->message.raw[pos], CRC32_HEX_LENGTH,
-                         message->crc, sizeof(message->crc)) == false)
+    payload_size = token.message_size - (TYPE_HEX_LENGTH + LENGTH_HEX_LENGTH);
+    if ((size_t)(uint8_t) message->length <= CRC_SIZE || payload_size >= sizeof(message->message.raw))
     {
-        DEBUG_ERROR("Could not convert hex to bin");
-        fclose(fp);
-        g_errno = ERROR_CONVERSION;
+        DEBUG_ERROR("Wrong message size");
+        g_errno = ERROR_LENGTH;
         return false;
     }
+    memcpy(message->message.raw, &token.message[TYPE_HEX_LENGTH + LENGTH_HEX_LENGTH], payload_size);
+    message->message.raw[payload_size] = '\0';
+    message->message.size = payload_size;
 
-    uint32_t calculated = crc32_calculate(message->data, (size_t) message->length - CRC_SIZE);
+    memcpy(message->mask.raw, token.mask, token.mask_size);
+    message->mask.raw[token.mask_size] = '\0';
+    message->mask.size = token.mask_size;
 
-    if (htonl(*(uint32_t*)message->crc) != calculated)
-    {
-        DEBUG_ERROR("Wrong CRC, should be=%08x, got=%08x", calculated, htonl(*(uint32_t*)message->crc));
-        fclose(fp);
-        g_errno = ERROR_CRC;
+    if (message_decode(message) == false)
         return false;
+
+    if (consumed != NULL)
+        *consumed = token.size;
+
+    return true;
+}
+
+bool message_parse(const char *src, size_t size, bool correct, message_t *message, size_t *consumed)
+{
+    if (message_parse_record(src, size, message, consumed) == false)
+        return false;
+
+    return message_check_crc(message, crc32_calculate(message->data, (size_t)(uint8_t) message->length - CRC_SIZE),
+                             correct);
+}
+
+void message_parse_batch(const char * const *srcs, const size_t *sizes, size_t count, bool correct,
+                         message_t *messages, error_e *errors)
+{
+    const char *data[MESSAGE_BATCH_MAX_SIZE] = {0};
+    size_t data_sizes[MESSAGE_BATCH_MAX_SIZE] = {0};
+    uint32_t crcs[MESSAGE_BATCH_MAX_SIZE] = {0};
+    size_t lanes[MESSAGE_BATCH_MAX_SIZE] = {0};
+    size_t valid = 0;
+    uint64_t begin = 0;
+
+    if (srcs == NULL || sizes == NULL || messages == NULL || errors == NULL || count > MESSAGE_BATCH_MAX_SIZE)
+    {
+        DEBUG_ERROR("Invalid parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return;
     }
 
-    if (utils_hex_to_bin(message->mask.raw, message->mask.size, message->mask_val, sizeof(message->mask_val)) == false)
+    for (size_t i = 0; i < count; i++)
     {
-        DEBUG_ERROR("Could not convert hex to bin");
-        fclose(fp);
-        g_errno = ERROR_CONVERSION;
-        return false;
+        begin = TRACE_BEGIN();
+        g_errno = ERROR_NO_ERROR;
+        if (message_parse_record(srcs[i], sizes[i], &messages[i], NULL) == false)
+            errors[i] = g_errno;
+        else
+            errors[i] = ERROR_NO_ERROR;
+        TRACE_END(TRACE_STAGE_LOAD, begin, TRACE_LANE(i), 1);
+
+        if (errors[i] != ERROR_NO_ERROR)
+            continue;
+
+        data[valid] = messages[i].data;
+        data_sizes[valid] = (size_t)(uint8_t) messages[i].length - CRC_SIZE;
+        lanes[valid++] = i;
     }
 
-    fclose(fp);
+    begin = TRACE_BEGIN();
+    crc32_calculate_multi(data, data_sizes, valid, crcs);
 
-    return true;
+    for (size_t i = 0; i < valid; i++)
+    {
+        if (message_check_crc(&messages[lanes[i]], crcs[i], correct) == false)
+            errors[lanes[i]] = g_errno;
+    }
+    message_trace_lanes(TRACE_STAGE_VERIFY, begin, lanes, valid);
 }
 
-bool message_update(const message_t *original, message_t *modified)
+/**
+ * @brief Build the modified message from the original one, except for its CRC
+ */
+static bool message_prepare(const message_t *original, message_t *modified)
 {
     uint32_t mask = 0;
     size_t append = 0;
-    uint32_t crc = 0;
 
     if (original == NULL || modified == NULL)
     {
@@ -174,22 +277,79 @@ bool message_update(const message_t *original, message_t *modified)
 
     memcpy((char*)&mask, &original->mask_val[0], sizeof(uint32_t));
 
-    append = ((size_t) original->length - CRC_SIZE) % ALIGN_APPEND;
+    append = ((size_t)(uint8_t) original->length - CRC_SIZE) % ALIGN_APPEND;
+    if ((size_t)(uint8_t) original->length + append > UINT8_MAX)
+    {
+        DEBUG_ERROR("Appending %ld bytes overflows the message length", append);
+        g_errno = ERROR_LENGTH;
+        return false;
+    }
 
-    memcpy(&modified->data[0], &original->data[0], (size_t) original->length - CRC_SIZE);
+    memcpy(&modified->data[0], &original->data[0], (size_t)(uint8_t) original->length - CRC_SIZE);
     modified->length = original->length;
 
+    /* padding is the normal case, and this runs for every record: nothing is printed */
     if (append != 0)
     {
-        DEBUG_WARN("Info! appending %ld bytes on data bytes", append);
-        modified->length += (char) append;
-        memset(&modified->data[(uint8_t)modified->length], 0, sizeof(char) * append);
+        memset(&modified->data[(uint8_t) modified->length - CRC_SIZE], 0, sizeof(char) * append);
+        modified->length = (char)((uint8_t) modified->length + append);
     }
 
-    utils_apply_mask_on_tetrads(modified->data, (size_t) modified->length - CRC_SIZE, *(uint32_t*)&original->mask_val);
+    utils_apply_mask_on_tetrads(modified->data, (size_t)(uint8_t) modified->length - CRC_SIZE, *(uint32_t*)&original->mask_val);
+
+    return true;
+}
+
+bool message_update(const message_t *original, message_t *modified)
+{
+    uint32_t crc = 0;
 
-    crc = crc32_calculate(modified->data, (size_t) modified->length - CRC_SIZE);
+    if (message_prepare(original, modified) == false)
+        return false;
+
+    crc = crc32_calculate(modified->data, (size_t)(uint8_t) modified->length - CRC_SIZE);
     memcpy(&modified->crc[0], (char*)&crc, sizeof(uint32_t));
 
     return true;
 }
+
+void message_update_batch(const message_t *originals, message_t *modified, size_t count, error_e *errors)
+{
+    const char *data[MESSAGE_BATCH_MAX_SIZE] = {0};
+    size_t data_sizes[MESSAGE_BATCH_MAX_SIZE] = {0};
+    uint32_t crcs[MESSAGE_BATCH_MAX_SIZE] = {0};
+    size_t lanes[MESSAGE_BATCH_MAX_SIZE] = {0};
+    size_t valid = 0;
+    uint64_t begin = TRACE_BEGIN();
+
+    if (originals == NULL || modified == NULL || errors == NULL || count > MESSAGE_BATCH_MAX_SIZE)
+    {
+        DEBUG_ERROR("Invalid parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (errors[i] != ERROR_NO_ERROR)
+            continue;
+
+        g_errno = ERROR_NO_ERROR;
+        if (message_prepare(&originals[i], &modified[i]) == false)
+        {
+            errors[i] = g_errno;
+            continue;
+        }
+
+        data[valid] = modified[i].data;
+        data_sizes[valid] = (size_t)(uint8_t) modified[i].length - CRC_SIZE;
+        lanes[valid++] = i;
+    }
+
+    crc32_calculate_multi(data, data_sizes, valid, crcs);
+
+    for (size_t i = 0; i < valid; i++)
+        memcpy(&modified[lanes[i]].crc[0], (char*)&crcs[i], sizeof(uint32_t));
+
+    message_trace_lanes(TRACE_STAGE_UPDATE, begin, lanes, valid);
+}
@@ -6,10 +6,11 @@
 #include <stdbool.h>
 #include <string.h>
 
-#define DELIMITER_INCLUSIVE         (true)  ///< Read until marker found, include marker
-#define DELIMITER_EXCLUSIVE         (false) ///< Read until marker is found, do not include marker
+#include "errors.h"
+#include "crc32.h"
 
 #define ALIGN_APPEND                UINT8_C(4)      ///< Definition of the requested alignment
+#define MESSAGE_BATCH_MAX_SIZE      CRC32_MAX_LANES ///< Most messages handled by one *_batch() call
 
 static const char g_message_leading_keyword[] = "mess=";    ///< leading keyword for message
 static const int g_message_leading_length = strlen(g_message_leading_keyword);  ///< leading keyword message length
@@ -59,6 +60,7 @@ typedef struct message_s {
     char data[DATA_SIZE];   ///< Stores the message data
     char crc[CRC_SIZE];     ///< Stores the message CRC
     char mask_val[MASK_SIZE];   ///< stores the message mask
+    bool corrected;         ///< One flipped bit of the data or CRC was repaired, see message_parse()
 
     /**
      * @brief Structure that stores the raw message bytes from the file
@@ -81,9 +83,42 @@ typedef struct message_s {
  * @brief Loads the message from the specified file
  *
  * @param[in] filename The filename where should read the message
+ * @param[in] correct Repair a single-bit error, see message_parse()
  * @param[out] message The pointer to the message structure that will store the message
  */
-bool message_load(const char *filename, message_t *message);
+bool message_load(const char *filename, bool correct, message_t *message);
+
+/**
+ * @brief Parses one message record ("mess=" line followed by "mask=" line) from the given buffer
+ *
+ * With @p correct, a message whose CRC does not match is looked up with
+ * crc32_locate_error(): if one flipped bit of the data or of the CRC
+ * explains the mismatch, it is flipped back, the CRC is checked again and
+ * the message is marked as corrected instead of failing with ERROR_CRC.
+ * Messages whose CRC matches do not go through it.
+ *
+ * @param[in] src The buffer where the record starts
+ * @param[in] size The size of @p src buffer
+ * @param[in] correct Repair a single-bit error instead of failing with ERROR_CRC
+ * @param[out] message The pointer to the message structure that will store the message
+ * @param[out] consumed How many bytes of @p src the record spans (may be NULL)
+ *
+ * @retval True if success; false otherwise
+ */
+bool message_parse(const char *src, size_t size, bool correct, message_t *message, size_t *consumed);
+
+/**
+ * @brief Parses several records, verifying their CRCs together with crc32_calculate_multi()
+ *
+ * @param[in] srcs The buffers where each record starts
+ * @param[in] sizes The size of each buffer of @p srcs
+ * @param[in] count How many records there are (at most MESSAGE_BATCH_MAX_SIZE)
+ * @param[in] correct Repair a single-bit error, see message_parse()
+ * @param[out] messages Where each parsed message is stored
+ * @param[out] errors ERROR_NO_ERROR for each record parsed; the error code otherwise
+ */
+void message_parse_batch(const char * const *srcs, const size_t *sizes, size_t count, bool correct,
+                         message_t *messages, error_e *errors);
 
 /**
  * @brief Update the original message according to the project's specification
@@ -96,4 +131,17 @@ bool message_load(const char *filename, message_t *message);
  */
 bool message_update(const message_t *original, message_t *modified);
 
+/**
+ * @brief Update several messages, computing the new CRCs together with crc32_calculate_multi()
+ *
+ * Messages whose entry in @p errors is already set (e.g. by message_parse_batch())
+ * are skipped.
+ *
+ * @param[in] originals The original parsed messages
+ * @param[out] modified Where each modified message is stored
+ * @param[in] count How many messages there are (at most MESSAGE_BATCH_MAX_SIZE)
+ * @param[in,out] errors ERROR_NO_ERROR for each message updated; the error code otherwise
+ */
+void message_update_batch(const message_t *originals, message_t *modified, size_t count, error_e *errors);
+
 #endif /* MESSAGE_H__ */
@@ -0,0 +1,363 @@
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include "options.h"
+#include "cache.h"
+#include "errors.h"
+#include "debug.h"
+
+/**
+ * @brief Values returned by getopt_long() for options that have no short form
+ */
+enum options_long_e {
+    OPTIONS_LONG_CHECKPOINT_INTERVAL = 256,     ///< --checkpoint-interval
+    OPTIONS_LONG_GZIP_BLOCK,                    ///< --gzip-block
+    OPTIONS_LONG_READER_CPUS,                   ///< --reader-cpus
+    OPTIONS_LONG_WORKER_CPUS,                   ///< --worker-cpus
+    OPTIONS_LONG_WRITER_CPUS,                   ///< --writer-cpus
+    OPTIONS_LONG_NUMA,                          ///< --numa
+    OPTIONS_LONG_BUSY_POLL,                     ///< --busy-poll
+    OPTIONS_LONG_TRACE_EVENTS,                  ///< --trace-events
+    OPTIONS_LONG_RING_SLOTS,                    ///< --ring-slots
+};
+
+static void options_usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -i, --input FILE      input file (default: %s)\n"
+            "  -o, --output FILE     output file (default: %s)\n"
+            "  -b, --batch           process every record of the input\n"
+            "  -c, --cache ENTRIES   cache the output of duplicate records (batch and server mode)\n"
+            "  -t, --threads N       worker threads formatting the output (batch and server mode, default: 1)\n"
+            "  -m, --mmap-output     preallocate and map the output file (batch mode)\n"
+            "  -s, --sharded         split the input in one shard per worker thread (batch mode)\n"
+            "  -k, --checkpoint FILE record the progress of the run in FILE (batch mode)\n"
+            "      --checkpoint-interval RECORDS\n"
+            "                        records between two checkpoints (default: %zu)\n"
+            "  -r, --resume          continue the run recorded in the checkpoint file\n"
+            "  -q, --quarantine FILE keep going past failing records, copying them into FILE (batch mode)\n"
+            "  -p, --partition       write OUTPUT.TT per message type TT and the OUTPUT.idx index (batch mode)\n"
+            "  -C, --correct         repair records whose CRC mismatch is a single flipped bit\n"
+            "  -T, --trace FILE      save the timing of every stage of every record into FILE (batch mode)\n"
+            "      --trace-events N  events kept per thread, the oldest are overwritten (default: %zu)\n"
+            "  -z, --gzip LEVEL      write gzip output compressed at LEVEL 1-9 (batch mode)\n"
+            "      --gzip-block SIZE bytes deflated per block by each thread (default: %zu)\n"
+            "      --reader-cpus LIST\n"
+            "                        pin the input thread to the CPUs in LIST (e.g. 0-3,8)\n"
+            "      --worker-cpus LIST\n"
+            "                        pin the worker threads to the CPUs in LIST, round robin\n"
+            "      --writer-cpus LIST\n"
+            "                        pin the output thread and the deflating threads\n"
+            "      --numa            allocate the memory of each pinned thread on its own NUMA node\n"
+            "  -S, --serve SOCKET    answer records sent over the Unix domain socket SOCKET\n"
+            "  -R, --ring NAME       answer records pushed by local producers into the shared memory NAME\n"
+            "      --ring-slots N    slots of the request and response rings, a power of two (default: %zu)\n"
+            "      --busy-poll       spin waiting for requests instead of sleeping (server and ring mode)\n"
+            "  -h, --help            show this help\n",
+            program, OPTIONS_DEFAULT_INPUT, OPTIONS_DEFAULT_OUTPUT,
+            OPTIONS_DEFAULT_CHECKPOINT_INTERVAL, OPTIONS_DEFAULT_TRACE_EVENTS, OPTIONS_DEFAULT_GZIP_BLOCK_SIZE,
+            RING_DEFAULT_SLOTS);
+}
+
+static bool options_parse_size(const char *name, const char *value, size_t *dst)
+{
+    unsigned long long parsed = 0;
+    char *endptr = NULL;
+
+    errno = 0;
+    parsed = strtoull(value, &endptr, 10);
+    if (errno != 0 || endptr == value || *endptr != '\0' || value[0] == '-')
+    {
+        DEBUG_ERROR("Invalid value \"%s\" for --%s", value, name);
+        g_errno = ERROR_CONVERSION;
+        return false;
+    }
+
+    *dst = (size_t) parsed;
+
+    return true;
+}
+
+bool options_parse(int argc, char **argv, options_t *options)
+{
+    static const struct option long_options[] = {
+        { "input",               required_argument, NULL, 'i' },
+        { "output",              required_argument, NULL, 'o' },
+        { "batch",               no_argument,       NULL, 'b' },
+        { "cache",               required_argument, NULL, 'c' },
+        { "threads",             required_argument, NULL, 't' },
+        { "mmap-output",         no_argument,       NULL, 'm' },
+        { "sharded",             no_argument,       NULL, 's' },
+        { "checkpoint",          required_argument, NULL, 'k' },
+        { "checkpoint-interval", required_argument, NULL, OPTIONS_LONG_CHECKPOINT_INTERVAL },
+        { "resume",              no_argument,       NULL, 'r' },
+        { "quarantine",          required_argument, NULL, 'q' },
+        { "partition",           no_argument,       NULL, 'p' },
+        { "correct",             no_argument,       NULL, 'C' },
+        { "trace",               required_argument, NULL, 'T' },
+        { "trace-events",        required_argument, NULL, OPTIONS_LONG_TRACE_EVENTS },
+        { "gzip",                required_argument, NULL, 'z' },
+        { "gzip-block",          required_argument, NULL, OPTIONS_LONG_GZIP_BLOCK },
+        { "reader-cpus",         required_argument, NULL, OPTIONS_LONG_READER_CPUS },
+        { "worker-cpus",         required_argument, NULL, OPTIONS_LONG_WORKER_CPUS },
+        { "writer-cpus",         required_argument, NULL, OPTIONS_LONG_WRITER_CPUS },
+        { "numa",                no_argument,       NULL, OPTIONS_LONG_NUMA },
+        { "serve",               required_argument, NULL, 'S' },
+        { "ring",                required_argument, NULL, 'R' },
+        { "ring-slots",          required_argument, NULL, OPTIONS_LONG_RING_SLOTS },
+        { "busy-poll",           no_argument,       NULL, OPTIONS_LONG_BUSY_POLL },
+        { "help",                no_argument,       NULL, 'h' },
+        { NULL,                  0,                 NULL, 0   },
+    };
+    size_t level = 0;
+    int option = 0;
+
+    if (argv == NULL || options == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    memset(options, 0, sizeof(*options));
+    options->input = OPTIONS_DEFAULT_INPUT;
+    options->output = OPTIONS_DEFAULT_OUTPUT;
+    options->threads = 1;
+    options->checkpoint_interval = OPTIONS_DEFAULT_CHECKPOINT_INTERVAL;
+    options->gzip_block_size = OPTIONS_DEFAULT_GZIP_BLOCK_SIZE;
+    options->trace_events = OPTIONS_DEFAULT_TRACE_EVENTS;
+    options->ring_slots = RING_DEFAULT_SLOTS;
+
+    while ((option = getopt_long(argc, argv, "i:o:bc:t:msk:rq:pCT:z:S:R:h", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+            case 'i':
+                options->input = optarg;
+                break;
+
+            case 'o':
+                options->output = optarg;
+                break;
+
+            case 'b':
+                options->batch = true;
+                break;
+
+            case 'c':
+                if (options_parse_size("cache", optarg, &options->cache_entries) == false)
+                    return false;
+                if (options->cache_entries > CACHE_MAX_ENTRIES)
+                {
+                    DEBUG_ERROR("--cache must be at most %zu", CACHE_MAX_ENTRIES);
+                    g_errno = ERROR_DATA_NOT_EXPECTED;
+                    return false;
+                }
+                break;
+
+            case 't':
+                if (options_parse_size("threads", optarg, &options->threads) == false)
+                    return false;
+                if (options->threads == 0 || options->threads > OPTIONS_MAX_THREADS)
+                {
+                    DEBUG_ERROR("--threads must be between 1 and %zu", OPTIONS_MAX_THREADS);
+                    g_errno = ERROR_DATA_NOT_EXPECTED;
+                    return false;
+                }
+                break;
+
+            case 'm':
+                options->mmap_output = true;
+                break;
+
+            case 's':
+                options->sharded = true;
+                break;
+
+            case 'k':
+                options->checkpoint = optarg;
+                break;
+
+            case OPTIONS_LONG_CHECKPOINT_INTERVAL:
+                if (options_parse_size("checkpoint-interval", optarg, &options->checkpoint_interval) == false)
+                    return false;
+                if (options->checkpoint_interval == 0)
+                {
+                    DEBUG_ERROR("--checkpoint-interval must be at least 1");
+                    g_errno = ERROR_DATA_NOT_EXPECTED;
+                    return false;
+                }
+                break;
+
+            case 'r':
+                options->resume = true;
+                break;
+
+            case 'q':
+                options->quarantine = optarg;
+                break;
+
+            case 'p':
+                options->partition = true;
+                break;
+
+            case 'C':
+                options->correct = true;
+                break;
+
+            case 'T':
+                options->trace = optarg;
+                break;
+
+            case OPTIONS_LONG_TRACE_EVENTS:
+                if (options_parse_size("trace-events", optarg, &options->trace_events) == false)
+                    return false;
+                if (options->trace_events == 0 || options->trace_events > UINT32_MAX)
+                {
+                    DEBUG_ERROR("--trace-events must be between 1 and %" PRIu32, UINT32_MAX);
+                    g_errno = ERROR_DATA_NOT_EXPECTED;
+                    return false;
+                }
+                break;
+
+            case 'z':
+                if (options_parse_size("gzip", optarg, &level) == false)
+                    return false;
+                if (level < 1 || level > 9)
+                {
+                    DEBUG_ERROR("--gzip must be between 1 and 9");
+                    g_errno = ERROR_DATA_NOT_EXPECTED;
+                    return false;
+                }
+                options->gzip_level = (int) level;
+                break;
+
+            case OPTIONS_LONG_GZIP_BLOCK:
+                if (options_parse_size("gzip-block", optarg, &options->gzip_block_size) == false)
+                    return false;
+                if (options->gzip_block_size < OPTIONS_MIN_GZIP_BLOCK_SIZE || options->gzip_block_size > UINT32_MAX)
+                {
+                    DEBUG_ERROR("--gzip-block must be between %zu and %" PRIu32, OPTIONS_MIN_GZIP_BLOCK_SIZE, UINT32_MAX);
+                    g_errno = ERROR_DATA_NOT_EXPECTED;
+                    return false;
+                }
+                break;
+
+            case OPTIONS_LONG_READER_CPUS:
+                if (affinity_parse(optarg, &options->reader_cpus) == false)
+                    return false;
+                break;
+
+            case OPTIONS_LONG_WORKER_CPUS:
+                if (affinity_parse(optarg, &options->worker_cpus) == false)
+                    return false;
+                break;
+
+            case OPTIONS_LONG_WRITER_CPUS:
+                if (affinity_parse(optarg, &options->writer_cpus) == false)
+                    return false;
+                break;
+
+            case OPTIONS_LONG_NUMA:
+                options->numa = true;
+                break;
+
+            case 'S':
+                options->socket = optarg;
+                break;
+
+            case 'R':
+                options->ring = optarg;
+                break;
+
+            case OPTIONS_LONG_RING_SLOTS:
+                if (options_parse_size("ring-slots", optarg, &options->ring_slots) == false)
+                    return false;
+                if (options->ring_slots == 0 || options->ring_slots > RING_MAX_SLOTS ||
+                    (options->ring_slots & (options->ring_slots - 1)) != 0)
+                {
+                    DEBUG_ERROR("--ring-slots must be a power of two up to %zu", RING_MAX_SLOTS);
+                    g_errno = ERROR_DATA_NOT_EXPECTED;
+                    return false;
+                }
+                break;
+
+            case OPTIONS_LONG_BUSY_POLL:
+                options->busy_poll = true;
+                break;
+
+            case 'h':
+                options_usage(argv[0]);
+                return false;
+
+            default:
+                options_usage(argv[0]);
+                g_errno = ERROR_DATA_NOT_EXPECTED;
+                return false;
+        }
+    }
+
+    if (optind != argc)
+    {
+        options_usage(argv[0]);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    if (options->resume == true && options->checkpoint == NULL)
+    {
+        DEBUG_ERROR("--resume needs --checkpoint");
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    if (options->gzip_level != 0 && options->mmap_output == true)
+    {
+        DEBUG_ERROR("--gzip and --mmap-output cannot be used together");
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    if (options->quarantine != NULL && options->batch == false)
+    {
+        DEBUG_ERROR("--quarantine needs --batch");
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    if (options->partition == true &&
+        (options->batch == false || options->mmap_output == true || options->gzip_level != 0 || options->checkpoint != NULL))
+    {
+        DEBUG_ERROR("--partition needs --batch and cannot be used with --mmap-output, --gzip or --checkpoint");
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    if (options->trace != NULL && options->batch == false)
+    {
+        DEBUG_ERROR("--trace needs --batch");
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    if (options->socket != NULL && options->batch == true)
+    {
+        DEBUG_ERROR("--serve and --batch cannot be used together");
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    if (options->ring != NULL && (options->batch == true || options->socket != NULL))
+    {
+        DEBUG_ERROR("--ring cannot be used with --batch or --serve");
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef OPTIONS_H__
+#define OPTIONS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "affinity.h"
+#include "ring.h"
+
+#define OPTIONS_DEFAULT_INPUT       ("data_in.txt")     ///< Input file used when none is given
+#define OPTIONS_DEFAULT_OUTPUT      ("data_out.txt")    ///< Output file used when none is given
+#define OPTIONS_MAX_THREADS         (size_t)UINT16_C(1024)  ///< Upper bound of worker threads
+#define OPTIONS_DEFAULT_CHECKPOINT_INTERVAL (size_t)UINT32_C(1000000)  ///< Records between two checkpoints
+#define OPTIONS_DEFAULT_GZIP_BLOCK_SIZE     (size_t)UINT32_C(131072)   ///< Output bytes deflated as one independent block
+#define OPTIONS_MIN_GZIP_BLOCK_SIZE         (size_t)UINT32_C(4096)     ///< Smallest accepted --gzip-block
+#define OPTIONS_DEFAULT_TRACE_EVENTS        (size_t)UINT32_C(1048576)  ///< Events kept per traced thread
+
+/**
+ * @brief Command line options of the application
+ */
+typedef struct options_s {
+    const char *input;          ///< Input file to be read
+    const char *output;         ///< Output file to be written
+    bool batch;                 ///< Process every record of the input instead of only the first one
+    size_t cache_entries;       ///< Entries of the duplicate record cache (per worker); 0 disables it
+    size_t threads;             ///< Number of worker threads formatting the output
+    bool mmap_output;           ///< Format straight into the preallocated, mapped output file
+    bool sharded;               ///< Workers also parse their own shard of the input
+    const char *checkpoint;     ///< Checkpoint file recording the progress of the run (may be NULL)
+    size_t checkpoint_interval; ///< Records processed between two checkpoints
+    bool resume;                ///< Continue the run recorded in the checkpoint file
+    int gzip_level;             ///< Compression level of the gzip output (1 to 9); 0 writes plain text
+    size_t gzip_block_size;     ///< Output bytes deflated as one independent block
+    affinity_t reader_cpus;     ///< CPUs of the thread reading (inflating) the input
+    affinity_t worker_cpus;     ///< CPUs of the worker threads, handed out round robin
+    affinity_t writer_cpus;     ///< CPUs of the thread writing the output (and of the deflating threads)
+    bool numa;                  ///< Place the memory of each thread on the NUMA node of its CPU
+    const char *socket;         ///< Unix domain socket to serve requests on (may be NULL)
+    bool busy_poll;             ///< Spin on the event queue or the rings instead of sleeping (server and ring mode)
+    const char *ring;           ///< Shared memory object co-located producers push records into (may be NULL)
+    size_t ring_slots;          ///< Slots of each ring of the shared memory object
+    bool partition;             ///< Split the output into one stream per message type, indexed in a sidecar file
+    const char *quarantine;     ///< File collecting the failing records, which no longer stop the run (may be NULL)
+    bool correct;               ///< Repair records whose CRC mismatch is a single flipped bit
+    const char *trace;          ///< File the per-thread stage events are saved into (may be NULL)
+    size_t trace_events;        ///< Events kept per traced thread; older ones are overwritten
+} options_t;
+
+/**
+ * @brief Parse the command line into the options structure, filling defaults for what is not given
+ *
+ * @param[in] argc The number of arguments
+ * @param[in] argv The arguments
+ * @param[out] options Where the parsed options are stored
+ *
+ * @retval True if success; false if the command line is not valid or help was requested
+ */
+bool options_parse(int argc, char **argv, options_t *options);
+
+#endif /* OPTIONS_H__ */
@@ -0,0 +1,620 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#include "output.h"
+#include "errors.h"
+#include "utils.h"
+#include "affinity.h"
+#include "debug.h"
+
+#define OUTPUT_GZIP_WINDOW_BITS     (-15)   ///< Raw deflate: the gzip header and trailer are written here
+#define OUTPUT_GZIP_MEM_LEVEL       (8)     ///< zlib default memory level
+#define OUTPUT_GZIP_FLUSH_MARGIN    (16)    ///< Room for the empty stored block of Z_SYNC_FLUSH
+
+static const unsigned char g_gzip_header[] = {
+    0x1f, 0x8b,                 // magic
+    0x08,                       // deflate
+    0x00,                       // no flags
+    0x00, 0x00, 0x00, 0x00,     // no modification time
+    0x00,                       // no extra flags
+    0x03,                       // Unix
+};
+
+/**
+ * @brief One block of output deflated on its own
+ */
+typedef struct output_block_s {
+    const char *src;            ///< Uncompressed bytes
+    size_t size;                ///< Number of bytes in @p src
+    bool last;                  ///< Last block of the gzip member (Z_FINISH instead of Z_SYNC_FLUSH)
+    unsigned char *dst;         ///< Deflated bytes
+    size_t dst_size;            ///< The size of @p dst buffer
+    size_t written;             ///< How many bytes were written into @p dst
+    uLong crc;                  ///< CRC-32 of @p src
+    bool failed;                ///< zlib refused the block
+} output_block_t;
+
+/**
+ * @brief One deflating thread, compressing every @p step-th block starting at @p first
+ */
+typedef struct output_deflater_s {
+    pthread_t thread;           ///< The deflating thread
+    z_stream stream;            ///< Raw deflate state, reset for every block
+    bool initialized;           ///< @p stream must be released with deflateEnd()
+    output_block_t *blocks;     ///< Blocks of the current commit
+    size_t first;               ///< First block handled by this thread
+    size_t count;               ///< Number of blocks of the current commit
+    size_t step;                ///< Number of deflating threads taking part
+    int cpu;                    ///< CPU the thread is pinned to (AFFINITY_NONE if not pinned)
+    int node;                   ///< NUMA node the thread allocates from (AFFINITY_NONE if any)
+} output_deflater_t;
+
+struct output_gzip_s {
+    output_deflater_t *deflaters;   ///< One per thread
+    size_t threads;                 ///< Number of deflating threads
+    size_t block_size;              ///< Uncompressed bytes per block
+    output_block_t *blocks;         ///< Blocks of the current commit
+    size_t capacity;                ///< Entries of @p blocks
+    size_t pending;                 ///< Bytes at the start of the output buffer not deflated yet
+    bool member;                    ///< The header of the current gzip member was written
+    uLong crc;                      ///< CRC-32 of the current member so far
+    uLong total;                    ///< Uncompressed size of the current member so far
+};
+
+static void output_deflate_block(z_stream *stream, output_block_t *block)
+{
+    int status = Z_OK;
+
+    deflateReset(stream);
+    stream->next_in = (Bytef *)(uintptr_t) block->src;
+    stream->avail_in = (uInt) block->size;
+    stream->next_out = block->dst;
+    stream->avail_out = (uInt) block->dst_size;
+
+    /*
+     * Every block is a raw deflate stream of its own: the ones in the middle
+     * end byte aligned and without the final bit, so they can simply be
+     * concatenated, and the last one closes the member.
+     */
+    status = deflate(stream, (block->last == true) ? Z_FINISH : Z_SYNC_FLUSH);
+
+    block->written = block->dst_size - stream->avail_out;
+    block->crc = crc32(0, (const Bytef *) block->src, (uInt) block->size);
+    block->failed = (stream->avail_in != 0 || stream->avail_out == 0 ||
+                     status != ((block->last == true) ? Z_STREAM_END : Z_OK));
+}
+
+static void *output_deflate_run(void *argument)
+{
+    output_deflater_t *deflater = argument;
+
+    if (affinity_prefer_node(deflater->node) == false)
+        DEBUG_WARN("The deflate buffers are not placed on node %d", deflater->node);
+
+    for (size_t i = deflater->first; i < deflater->count; i += deflater->step)
+        output_deflate_block(&deflater->stream, &deflater->blocks[i]);
+
+    return NULL;
+}
+
+static bool output_gzip_write(output_t *output, const void *data, size_t size)
+{
+    if (fwrite(data, sizeof(char), size, output->fp) != size)
+    {
+        DEBUG_ERROR("Could not write into file \"%s\"", output->filename);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+    output->offset += size;
+
+    return true;
+}
+
+static bool output_gzip_reserve_blocks(output_gzip_t *gzip, size_t count)
+{
+    output_block_t *blocks = NULL;
+    const size_t dst_size = deflateBound(&gzip->deflaters[0].stream, (uLong) gzip->block_size) + OUTPUT_GZIP_FLUSH_MARGIN;
+
+    if (count <= gzip->capacity)
+        return true;
+
+    blocks = realloc(gzip->blocks, count * sizeof(*blocks));
+    if (blocks == NULL)
+        return false;
+    gzip->blocks = blocks;
+
+    for (; gzip->capacity < count; gzip->capacity++)
+    {
+        memset(&blocks[gzip->capacity], 0, sizeof(*blocks));
+        blocks[gzip->capacity].dst = malloc(dst_size);
+        if (blocks[gzip->capacity].dst == NULL)
+            return false;
+        blocks[gzip->capacity].dst_size = dst_size;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Deflate @p size bytes of @p src in blocks, in parallel, and append them to the current member
+ */
+static bool output_gzip_deflate(output_t *output, const char *src, size_t size, bool last)
+{
+    output_gzip_t *gzip = output->gzip;
+    size_t count = (size + gzip->block_size - 1) / gzip->block_size;
+    pthread_attr_t attr;
+    size_t workers = 0;
+    size_t started = 0;
+    bool success = true;
+
+    if (last == true && count == 0)
+        count = 1;
+
+    if (count == 0)
+        return true;
+
+    if (output_gzip_reserve_blocks(gzip, count) == false)
+    {
+        DEBUG_ERROR("Could not allocate %zu output blocks", count);
+        g_errno = ERROR_BUFFER_SIZE;
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        gzip->blocks[i].src = &src[i * gzip->block_size];
+        gzip->blocks[i].size = MIN(gzip->block_size, size - i * gzip->block_size);
+        gzip->blocks[i].last = (last == true && i + 1 == count);
+    }
+
+    workers = MIN(gzip->threads, count);
+    for (size_t i = 0; i < workers; i++)
+    {
+        gzip->deflaters[i].blocks = gzip->blocks;
+        gzip->deflaters[i].first = i;
+        gzip->deflaters[i].count = count;
+        gzip->deflaters[i].step = workers;
+    }
+
+    if (workers == 1)
+    {
+        output_deflate_run(&gzip->deflaters[0]);
+    }
+    else
+    {
+        for (started = 0; started < workers; started++)
+        {
+            pthread_attr_init(&attr);
+            success = affinity_set_attr(&attr, gzip->deflaters[started].cpu);
+            if (success == true &&
+                pthread_create(&gzip->deflaters[started].thread, &attr,
+                               output_deflate_run, &gzip->deflaters[started]) != 0)
+            {
+                DEBUG_ERROR("Could not start deflating thread %zu", started);
+                g_errno = ERROR_BUFFER_SIZE;
+                success = false;
+            }
+            pthread_attr_destroy(&attr);
+
+            if (success == false)
+                break;
+        }
+
+        for (size_t i = 0; i < started; i++)
+            pthread_join(gzip->deflaters[i].thread, NULL);
+
+        if (success == false)
+            return false;
+    }
+
+    if (gzip->member == false)
+    {
+        if (output_gzip_write(output, g_gzip_header, sizeof(g_gzip_header)) == false)
+            return false;
+        gzip->member = true;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (gzip->blocks[i].failed == true)
+        {
+            DEBUG_ERROR("Could not deflate %zu bytes of output", gzip->blocks[i].size);
+            g_errno = ERROR_CONVERSION;
+            return false;
+        }
+
+        if (output_gzip_write(output, gzip->blocks[i].dst, gzip->blocks[i].written) == false)
+            return false;
+
+        gzip->crc = crc32_combine(gzip->crc, gzip->blocks[i].crc, (z_off_t) gzip->blocks[i].size);
+        gzip->total += (uLong) gzip->blocks[i].size;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Deflate what is pending as the last block and write the member trailer
+ */
+static bool output_gzip_finish(output_t *output)
+{
+    output_gzip_t *gzip = output->gzip;
+    unsigned char trailer[8] = {0};
+
+    if (gzip->member == false && gzip->pending == 0 && output->offset != 0)
+        return true;
+
+    if (output_gzip_deflate(output, output->buffer, gzip->pending, true) == false)
+        return false;
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        trailer[i] = (unsigned char)(gzip->crc >> (8 * i));
+        trailer[4 + i] = (unsigned char)(gzip->total >> (8 * i));
+    }
+
+    if (output_gzip_write(output, trailer, sizeof(trailer)) == false)
+        return false;
+
+    gzip->pending = 0;
+    gzip->member = false;
+    gzip->crc = crc32(0, NULL, 0);
+    gzip->total = 0;
+
+    return true;
+}
+
+static void output_gzip_destroy(output_gzip_t *gzip)
+{
+    if (gzip == NULL)
+        return;
+
+    for (size_t i = 0; i < gzip->threads && gzip->deflaters != NULL; i++)
+    {
+        if (gzip->deflaters[i].initialized == true)
+            deflateEnd(&gzip->deflaters[i].stream);
+    }
+
+    for (size_t i = 0; i < gzip->capacity; i++)
+        free(gzip->blocks[i].dst);
+
+    free(gzip->blocks);
+    free(gzip->deflaters);
+    free(gzip);
+}
+
+static output_gzip_t *output_gzip_create(const options_t *options)
+{
+    output_gzip_t *gzip = NULL;
+
+    gzip = calloc(1, sizeof(*gzip));
+    if (gzip == NULL)
+        return NULL;
+
+    gzip->threads = options->threads;
+    gzip->block_size = options->gzip_block_size;
+    gzip->crc = crc32(0, NULL, 0);
+
+    gzip->deflaters = calloc(gzip->threads, sizeof(*gzip->deflaters));
+    if (gzip->deflaters == NULL)
+    {
+        output_gzip_destroy(gzip);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < gzip->threads; i++)
+    {
+        if (deflateInit2(&gzip->deflaters[i].stream, options->gzip_level, Z_DEFLATED,
+                         OUTPUT_GZIP_WINDOW_BITS, OUTPUT_GZIP_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            output_gzip_destroy(gzip);
+            return NULL;
+        }
+        gzip->deflaters[i].initialized = true;
+        gzip->deflaters[i].cpu = affinity_cpu(&options->writer_cpus, i);
+        gzip->deflaters[i].node = (options->numa == true) ? affinity_node(gzip->deflaters[i].cpu) : AFFINITY_NONE;
+    }
+
+    return gzip;
+}
+
+bool output_open(output_t *output, const options_t *options, size_t offset)
+{
+    const int flags = O_RDWR | O_CREAT | ((offset == 0) ? O_TRUNC : 0);
+    struct stat status;
+
+    if (output == NULL || options == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    memset(output, 0, sizeof(*output));
+    output->filename = options->output;
+    output->mode = (options->mmap_output == true) ? OUTPUT_MODE_MMAP : OUTPUT_MODE_STDIO;
+    if (options->gzip_level != 0)
+        output->mode = OUTPUT_MODE_GZIP;
+
+    output->fd = open(output->filename, flags, 0644);
+    if (output->fd == -1)
+    {
+        DEBUG_ERROR("Creating/opening \"%s\" file", output->filename);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+
+    /* a shorter file lost output the checkpoint counts as written: extending it would leave a hole of NULs */
+    if (offset != 0 && (fstat(output->fd, &status) != 0 || (size_t) status.st_size < offset))
+    {
+        DEBUG_ERROR("\"%s\" is shorter than the %zu bytes the checkpoint recorded", output->filename, offset);
+        close(output->fd);
+        output->fd = -1;
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    if (offset != 0 && ftruncate(output->fd, (off_t) offset) != 0)
+    {
+        DEBUG_ERROR("Could not truncate \"%s\" to %zu bytes", output->filename, offset);
+        close(output->fd);
+        output->fd = -1;
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+    output->offset = offset;
+
+    switch (output->mode)
+    {
+        case OUTPUT_MODE_GZIP:
+            output->gzip = output_gzip_create(options);
+            if (output->gzip == NULL)
+            {
+                DEBUG_ERROR("Could not initialize the gzip output");
+                close(output->fd);
+                output->fd = -1;
+                g_errno = ERROR_BUFFER_SIZE;
+                return false;
+            }
+            /* fall through */
+
+        case OUTPUT_MODE_STDIO:
+            if (lseek(output->fd, (off_t) offset, SEEK_SET) == (off_t) -1)
+                output->fp = NULL;
+            else
+                output->fp = fdopen(output->fd, "w");
+
+            if (output->fp == NULL)
+            {
+                DEBUG_ERROR("Creating/opening \"%s\" file", output->filename);
+                output_gzip_destroy(output->gzip);
+                output->gzip = NULL;
+                close(output->fd);
+                output->fd = -1;
+                g_errno = ERROR_FILE_CREATION;
+                return false;
+            }
+            break;
+
+        case OUTPUT_MODE_MMAP:
+            break;
+
+        default:
+            DEBUG_ERROR("Unknown output mode %d", output->mode);
+            g_errno = ERROR_DATA_NOT_EXPECTED;
+            return false;
+    }
+
+    return true;
+}
+
+static char *output_reserve_mmap(output_t *output, size_t size)
+{
+    const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t aligned = output->offset & ~(page - 1);
+    void *map = NULL;
+    int error = 0;
+
+    error = fallocate(output->fd, 0, (off_t) output->offset, (off_t) size);
+    if (error != 0)
+        error = ftruncate(output->fd, (off_t)(output->offset + size));
+
+    if (error != 0)
+    {
+        DEBUG_ERROR("Could not extend file \"%s\" to %zu bytes", output->filename, output->offset + size);
+        g_errno = ERROR_FILE_CREATION;
+        return NULL;
+    }
+
+    output->map_delta = output->offset - aligned;
+    output->map_size = output->map_delta + size;
+    map = mmap(NULL, output->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, output->fd, (off_t) aligned);
+    if (map == MAP_FAILED)
+    {
+        DEBUG_ERROR("Could not map file \"%s\"", output->filename);
+        output->map_size = 0;
+        g_errno = ERROR_FILE_CREATION;
+        return NULL;
+    }
+    output->map = map;
+
+    return &output->map[output->map_delta];
+}
+
+char *output_reserve(output_t *output, size_t size)
+{
+    size_t pending = 0;
+    char *buffer = NULL;
+
+    if (output == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return NULL;
+    }
+
+    if (size == 0)
+        size = 1;
+
+    switch (output->mode)
+    {
+        case OUTPUT_MODE_GZIP:
+        case OUTPUT_MODE_STDIO:
+            if (output->gzip != NULL)
+                pending = output->gzip->pending;
+
+            if (pending + size > output->buffer_size)
+            {
+                buffer = realloc(output->buffer, pending + size);
+                if (buffer == NULL)
+                {
+                    DEBUG_ERROR("Could not allocate %zu bytes of output", pending + size);
+                    g_errno = ERROR_BUFFER_SIZE;
+                    return NULL;
+                }
+                output->buffer = buffer;
+                output->buffer_size = pending + size;
+            }
+            return &output->buffer[pending];
+
+        case OUTPUT_MODE_MMAP:
+            return output_reserve_mmap(output, size);
+
+        default:
+            DEBUG_ERROR("Unknown output mode %d", output->mode);
+            g_errno = ERROR_DATA_NOT_EXPECTED;
+            return NULL;
+    }
+}
+
+static bool output_gzip_commit(output_t *output, size_t size)
+{
+    output_gzip_t *gzip = output->gzip;
+    const size_t available = gzip->pending + size;
+    const size_t whole = available - available % gzip->block_size;
+
+    if (output_gzip_deflate(output, output->buffer, whole, false) == false)
+        return false;
+
+    memmove(output->buffer, &output->buffer[whole], available - whole);
+    gzip->pending = available - whole;
+
+    return true;
+}
+
+bool output_commit(output_t *output, size_t size)
+{
+    if (output == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    switch (output->mode)
+    {
+        case OUTPUT_MODE_STDIO:
+            if (fwrite(output->buffer, sizeof(char), size, output->fp) != size)
+            {
+                DEBUG_ERROR("Could not write into file \"%s\"", output->filename);
+                g_errno = ERROR_FILE_CREATION;
+                return false;
+            }
+            break;
+
+        case OUTPUT_MODE_GZIP:
+            return output_gzip_commit(output, size);
+
+        case OUTPUT_MODE_MMAP:
+            if (output->map != NULL)
+                munmap(output->map, output->map_size);
+            output->map = NULL;
+            output->map_size = 0;
+            break;
+
+        default:
+            DEBUG_ERROR("Unknown output mode %d", output->mode);
+            g_errno = ERROR_DATA_NOT_EXPECTED;
+            return false;
+    }
+
+    output->offset += size;
+
+    return true;
+}
+
+bool output_sync(output_t *output)
+{
+    if (output == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    if (output->gzip != NULL && output_gzip_finish(output) == false)
+        return false;
+
+    if ((output->fp != NULL && fflush(output->fp) != 0) || fdatasync(output->fd) != 0)
+    {
+        DEBUG_ERROR("Could not sync file \"%s\"", output->filename);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+
+    return true;
+}
+
+bool output_close(output_t *output)
+{
+    bool success = true;
+
+    if (output == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    if (output->gzip != NULL && output_gzip_finish(output) == false)
+        success = false;
+
+    if (output->fp != NULL && fflush(output->fp) != 0)
+        success = false;
+
+    if (output->map != NULL)
+        munmap(output->map, output->map_size);
+
+    if (output->fd != -1 && ftruncate(output->fd, (off_t) output->offset) != 0)
+        success = false;
+
+    if (output->fp != NULL)
+    {
+        if (fclose(output->fp) != 0)
+            success = false;
+    }
+    else if (output->fd != -1 && close(output->fd) != 0)
+    {
+        success = false;
+    }
+
+    output_gzip_destroy(output->gzip);
+    free(output->buffer);
+    memset(output, 0, sizeof(*output));
+    output->fd = -1;
+
+    if (success == false)
+    {
+        DEBUG_ERROR("Could not close the output file");
+        g_errno = ERROR_FILE_CREATION;
+    }
+
+    return success;
+}
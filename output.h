@@ -0,0 +1,103 @@
+#ifndef OUTPUT_H__
+#define OUTPUT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "options.h"
+
+/**
+ * @brief How the output blocks reach the output file
+ */
+typedef enum output_mode_e {
+    OUTPUT_MODE_STDIO,      ///< Blocks are formatted into a heap buffer and written with fwrite()
+    OUTPUT_MODE_MMAP,       ///< Blocks are formatted straight into the preallocated, mapped output file
+    OUTPUT_MODE_GZIP,       ///< Blocks are formatted into a heap buffer, deflated in parallel and written as gzip
+} output_mode_e;
+
+/**
+ * @brief State of the gzip output (see output.c)
+ */
+typedef struct output_gzip_s output_gzip_t;
+
+/**
+ * @brief Output file being written in consecutive windows
+ */
+typedef struct output_s {
+    output_mode_e mode;     ///< How the blocks reach the file
+    const char *filename;   ///< The output file
+    FILE *fp;               ///< Stream over @p fd used by OUTPUT_MODE_STDIO
+    int fd;                 ///< Descriptor of the output file
+    size_t offset;          ///< Bytes committed to the file so far
+    char *buffer;           ///< Heap window of OUTPUT_MODE_STDIO
+    size_t buffer_size;     ///< The size of @p buffer
+    char *map;              ///< Mapping of the current window in OUTPUT_MODE_MMAP
+    size_t map_size;        ///< The size of @p map
+    size_t map_delta;       ///< Distance between @p map and the window, due to page alignment
+    output_gzip_t *gzip;    ///< Deflating threads and stream state of OUTPUT_MODE_GZIP
+} output_t;
+
+/**
+ * @brief Create the output file, or reopen it keeping the first @p offset bytes
+ *
+ * @param[out] output The output to be initialized
+ * @param[in] options The application options (output file and mode)
+ * @param[in] offset Bytes of an earlier run to keep (resume); 0 truncates the file
+ *
+ * In OUTPUT_MODE_GZIP the offsets are positions in the compressed file,
+ * where output_sync() always leaves a complete gzip member.
+ *
+ * @retval True if success; false otherwise
+ */
+bool output_open(output_t *output, const options_t *options, size_t offset);
+
+/**
+ * @brief Get the window where the next @p size bytes of output must be written
+ *
+ * In OUTPUT_MODE_MMAP the file is extended with fallocate() and the window is
+ * a shared mapping of it, so several threads can fill disjoint parts of it.
+ *
+ * @param[in,out] output The output
+ * @param[in] size The size of the window
+ *
+ * @retval Returns the window; NULL otherwise
+ */
+char *output_reserve(output_t *output, size_t size);
+
+/**
+ * @brief Commit the first @p size bytes of the window returned by output_reserve()
+ *
+ * In OUTPUT_MODE_GZIP only whole blocks are deflated and written; the
+ * remainder is kept and written ahead of the next window.
+ *
+ * @param[in,out] output The output
+ * @param[in] size How many bytes of the window were produced
+ *
+ * @retval True if success; false otherwise
+ */
+bool output_commit(output_t *output, size_t size);
+
+/**
+ * @brief Make the committed bytes durable on disk
+ *
+ * In OUTPUT_MODE_GZIP the current gzip member is finished first, so the
+ * file is a valid (multi-member) gzip file up to the synced offset.
+ *
+ * @param[in,out] output The output
+ *
+ * @retval True if success; false otherwise
+ */
+bool output_sync(output_t *output);
+
+/**
+ * @brief Close the output file, truncating it at the committed size
+ *
+ * @param[in,out] output The output
+ *
+ * @retval True if success; false otherwise
+ */
+bool output_close(output_t *output);
+
+#endif /* OUTPUT_H__ */
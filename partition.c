@@ -0,0 +1,281 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "partition.h"
+#include "format.h"
+#include "crc32.h"
+#include "utils.h"
+#include "errors.h"
+#include "debug.h"
+
+#define PARTITION_FILENAME_SIZE     (size_t)UINT16_C(4096)  ///< Maximum size of a stream or index filename
+
+static FILE *partition_create(const char *prefix, const char *suffix, char *filename, size_t filename_size)
+{
+    FILE *fp = NULL;
+    int wrote = 0;
+
+    wrote = snprintf(filename, filename_size, "%s.%s", prefix, suffix);
+    if (wrote < 0 || (size_t) wrote >= filename_size)
+    {
+        DEBUG_ERROR("Output filename is too long");
+        g_errno = ERROR_BUFFER_SIZE;
+        return NULL;
+    }
+
+    fp = fopen(filename, "w");
+    if (fp == NULL)
+    {
+        DEBUG_ERROR("Creating/opening \"%s\" file", filename);
+        g_errno = ERROR_FILE_CREATION;
+        return NULL;
+    }
+
+    setvbuf(fp, NULL, _IOFBF, PARTITION_STREAM_BUFFER);
+
+    return fp;
+}
+
+static FILE *partition_stream(partition_t *partition, uint8_t type)
+{
+    char filename[PARTITION_FILENAME_SIZE] = {0};
+    char suffix[3] = {0};
+
+    if (partition->streams[type] != NULL)
+        return partition->streams[type];
+
+    snprintf(suffix, sizeof(suffix), "%02x", type);
+    partition->streams[type] = partition_create(partition->prefix, suffix, filename, sizeof(filename));
+
+    return partition->streams[type];
+}
+
+bool partition_open(partition_t *partition, const char *prefix)
+{
+    char filename[PARTITION_FILENAME_SIZE] = {0};
+    partition_header_t header;
+
+    if (partition == NULL || prefix == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    memset(partition, 0, sizeof(*partition));
+    partition->prefix = prefix;
+
+    partition->index = partition_create(prefix, "idx", filename, sizeof(filename));
+    if (partition->index == NULL)
+        return false;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PARTITION_INDEX_MAGIC, sizeof(header.magic));
+    header.version = PARTITION_INDEX_VERSION;
+    header.entry_size = (uint32_t) sizeof(partition_entry_t);
+
+    if (fwrite(&header, sizeof(header), 1, partition->index) != 1)
+    {
+        DEBUG_ERROR("Could not write into file \"%s\"", filename);
+        g_errno = ERROR_FILE_CREATION;
+        fclose(partition->index);
+        partition->index = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+char *partition_reserve(partition_t *partition, size_t size)
+{
+    char *buffer = NULL;
+
+    if (partition == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return NULL;
+    }
+
+    if (size == 0)
+        size = 1;
+
+    if (size > partition->buffer_size)
+    {
+        buffer = realloc(partition->buffer, size);
+        if (buffer == NULL)
+        {
+            DEBUG_ERROR("Could not allocate %zu bytes of output", size);
+            g_errno = ERROR_BUFFER_SIZE;
+            return NULL;
+        }
+        partition->buffer = buffer;
+        partition->buffer_size = size;
+    }
+
+    partition->count = 0;
+
+    return partition->buffer;
+}
+
+bool partition_queue(partition_t *partition, uint64_t seq, size_t length)
+{
+    partition_entry_t *entries = NULL;
+    size_t capacity = 0;
+
+    if (partition == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    if (partition->count == partition->capacity)
+    {
+        capacity = (partition->capacity == 0) ? 4096 : partition->capacity * 2;
+        entries = realloc(partition->entries, capacity * sizeof(*entries));
+        if (entries == NULL)
+        {
+            DEBUG_ERROR("Could not allocate %zu index entries", capacity);
+            g_errno = ERROR_BUFFER_SIZE;
+            return false;
+        }
+        partition->entries = entries;
+        partition->capacity = capacity;
+    }
+
+    memset(&partition->entries[partition->count], 0, sizeof(partition->entries[0]));
+    partition->entries[partition->count].seq = seq;
+    partition->entries[partition->count].length = (uint32_t) length;
+    partition->count++;
+
+    return true;
+}
+
+bool partition_commit(partition_t *partition, size_t size)
+{
+    const char *blocks[CRC32_MAX_LANES] = {0};
+    size_t lengths[CRC32_MAX_LANES] = {0};
+    uint32_t crcs[CRC32_MAX_LANES] = {0};
+    partition_entry_t *entry = NULL;
+    size_t lanes = 0;
+    size_t pos = 0;
+    FILE *stream = NULL;
+
+    if (partition == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    for (size_t first = 0; first < partition->count; first += lanes)
+    {
+        lanes = MIN(partition->count - first, CRC32_MAX_LANES);
+
+        for (size_t i = 0; i < lanes; i++)
+        {
+            entry = &partition->entries[first + i];
+            if (pos + entry->length > size ||
+                format_output_type(&partition->buffer[pos], entry->length, &entry->type) == false)
+            {
+                DEBUG_ERROR("Block of record %" PRIu64 " is not where it was queued", entry->seq);
+                g_errno = ERROR_DATA_NOT_EXPECTED;
+                return false;
+            }
+
+            blocks[i] = &partition->buffer[pos];
+            lengths[i] = entry->length;
+            pos += entry->length;
+        }
+
+        crc32_calculate_multi(blocks, lengths, lanes, crcs);
+
+        for (size_t i = 0; i < lanes; i++)
+        {
+            entry = &partition->entries[first + i];
+            entry->crc = crcs[i];
+            entry->offset = partition->offsets[entry->type];
+
+            stream = partition_stream(partition, entry->type);
+            if (stream == NULL)
+                return false;
+
+            if (fwrite(blocks[i], sizeof(char), lengths[i], stream) != lengths[i])
+            {
+                DEBUG_ERROR("Could not write the stream of type 0x%02x", entry->type);
+                g_errno = ERROR_FILE_CREATION;
+                return false;
+            }
+
+            partition->offsets[entry->type] += lengths[i];
+            partition->records[entry->type]++;
+        }
+    }
+
+    if (pos != size)
+    {
+        DEBUG_ERROR("%zu bytes of the window belong to no block", size - pos);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    if (partition->count != 0 &&
+        fwrite(partition->entries, sizeof(partition->entries[0]), partition->count, partition->index) != partition->count)
+    {
+        DEBUG_ERROR("Could not write the index");
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+    partition->count = 0;
+
+    return true;
+}
+
+void partition_report(const partition_t *partition)
+{
+    if (partition == NULL)
+        return;
+
+    for (size_t type = 0; type < PARTITION_TYPES; type++)
+    {
+        if (partition->records[type] != 0)
+            DEBUG_INFO("Type 0x%02zx: %zu records, %zu bytes into \"%s.%02zx\"",
+                       type, partition->records[type], partition->offsets[type], partition->prefix, type);
+    }
+}
+
+bool partition_close(partition_t *partition)
+{
+    bool success = true;
+
+    if (partition == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    for (size_t type = 0; type < PARTITION_TYPES; type++)
+    {
+        if (partition->streams[type] != NULL && fclose(partition->streams[type]) != 0)
+            success = false;
+    }
+
+    if (partition->index != NULL && fclose(partition->index) != 0)
+        success = false;
+
+    free(partition->buffer);
+    free(partition->entries);
+    memset(partition, 0, sizeof(*partition));
+
+    if (success == false)
+    {
+        DEBUG_ERROR("Could not close the partitioned output");
+        g_errno = ERROR_FILE_CREATION;
+    }
+
+    return success;
+}
@@ -0,0 +1,115 @@
+#ifndef PARTITION_H__
+#define PARTITION_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define PARTITION_TYPES             (size_t)(UINT8_MAX + 1)     ///< One stream per message type
+#define PARTITION_INDEX_MAGIC       ("AURIGAIX")                ///< First bytes of the index file
+#define PARTITION_INDEX_VERSION     UINT32_C(1)                 ///< Layout of the index file
+#define PARTITION_STREAM_BUFFER     (size_t)UINT32_C(262144)    ///< stdio buffer of each type stream and of the index
+
+/**
+ * @brief Header of the index file, followed by one partition_entry_t per record
+ */
+typedef struct partition_header_s {
+    char magic[8];          ///< PARTITION_INDEX_MAGIC, not NUL terminated
+    uint32_t version;       ///< PARTITION_INDEX_VERSION
+    uint32_t entry_size;    ///< sizeof(partition_entry_t), so that readers can check the layout
+} partition_header_t;
+
+/**
+ * @brief Where the output block of one record is, in host byte order
+ */
+typedef struct partition_entry_s {
+    uint64_t seq;           ///< Index of the record in the input
+    uint64_t offset;        ///< Offset of the block in the stream of its type
+    uint32_t length;        ///< Size of the block
+    uint32_t crc;           ///< CRC-32 of the block, as computed by crc32_calculate()
+    uint8_t type;           ///< Message type, which selects the stream
+    uint8_t reserved[7];    ///< Zero
+} partition_entry_t;
+
+/**
+ * @brief Output split into one stream per message type, plus the index of every block
+ *
+ * The stream of type TT is "<prefix>.TT" (two lower case hex digits) and
+ * the index is "<prefix>.idx". Streams are created with the first block of
+ * their type.
+ */
+typedef struct partition_s {
+    const char *prefix;                     ///< Name the stream and index names are built from
+    FILE *streams[PARTITION_TYPES];         ///< Stream of each type (NULL until its first block)
+    size_t offsets[PARTITION_TYPES];        ///< Bytes written into each stream
+    size_t records[PARTITION_TYPES];        ///< Blocks written into each stream
+    FILE *index;                            ///< The index file
+    char *buffer;                           ///< Window the blocks are formatted into
+    size_t buffer_size;                     ///< The size of @p buffer
+    partition_entry_t *entries;             ///< Blocks of the window, queued by partition_queue()
+    size_t count;                           ///< Entries queued in @p entries
+    size_t capacity;                        ///< Entries @p entries can hold
+} partition_t;
+
+/**
+ * @brief Create the index file; the type streams are created on demand
+ *
+ * @param[out] partition The partition to be initialized
+ * @param[in] prefix Name the stream and index names are built from
+ *
+ * @retval True if success; false otherwise
+ */
+bool partition_open(partition_t *partition, const char *prefix);
+
+/**
+ * @brief Get the window where the next @p size bytes of blocks must be formatted
+ *
+ * @param[in,out] partition The partition
+ * @param[in] size The size of the window
+ *
+ * @retval Returns the window; NULL otherwise
+ */
+char *partition_reserve(partition_t *partition, size_t size);
+
+/**
+ * @brief Announce the next block of the window, in window order
+ *
+ * @param[in,out] partition The partition
+ * @param[in] seq Index of the record in the input
+ * @param[in] length Size of the block
+ *
+ * @retval True if success; false otherwise
+ */
+bool partition_queue(partition_t *partition, uint64_t seq, size_t length);
+
+/**
+ * @brief Route the queued blocks of the window to the streams of their types and index them
+ *
+ * The blocks must lie back to back from the start of the window, in the
+ * order they were queued, and cover its first @p size bytes.
+ *
+ * @param[in,out] partition The partition
+ * @param[in] size How many bytes of the window were produced
+ *
+ * @retval True if success; false otherwise
+ */
+bool partition_commit(partition_t *partition, size_t size);
+
+/**
+ * @brief Print how many blocks went to each stream
+ *
+ * @param[in] partition The partition
+ */
+void partition_report(const partition_t *partition);
+
+/**
+ * @brief Flush and close the streams and the index
+ *
+ * @param[in,out] partition The partition
+ *
+ * @retval True if success; false otherwise
+ */
+bool partition_close(partition_t *partition);
+
+#endif /* PARTITION_H__ */
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "quarantine.h"
+#include "debug.h"
+
+bool quarantine_open(quarantine_t *quarantine, const char *filename, size_t offset)
+{
+    int fd = -1;
+
+    if (quarantine == NULL || filename == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    memset(quarantine, 0, sizeof(*quarantine));
+    quarantine->filename = filename;
+    quarantine->offset = offset;
+
+    /* records quarantined after the saved offset are found again by a resumed run */
+    fd = open(filename, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t) offset) != 0 || lseek(fd, (off_t) offset, SEEK_SET) < 0)
+    {
+        DEBUG_ERROR("Creating/opening \"%s\" file", filename);
+        if (fd >= 0)
+            close(fd);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+
+    quarantine->fp = fdopen(fd, "w");
+    if (quarantine->fp == NULL)
+    {
+        DEBUG_ERROR("Creating/opening \"%s\" file", filename);
+        close(fd);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+
+    return true;
+}
+
+bool quarantine_add(quarantine_t *quarantine, size_t record, size_t offset, error_e error,
+                    const char *data, size_t size)
+{
+    const char *description = error_string(error);
+    int wrote = 0;
+
+    if (quarantine == NULL || quarantine->fp == NULL || data == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    wrote = fprintf(quarantine->fp, "record=%zu offset=%zu error=%d (%s)\n",
+                    record, offset, error, (description != NULL) ? description : "Unknown error");
+    if (wrote < 0 || fwrite(data, sizeof(char), size, quarantine->fp) != size)
+    {
+        DEBUG_ERROR("Could not write into file \"%s\"", quarantine->filename);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+    quarantine->offset += (size_t) wrote + size;
+
+    /* the last record of the input may miss its new line */
+    if (size == 0 || data[size - 1] != '\n')
+    {
+        if (fputc('\n', quarantine->fp) == EOF)
+        {
+            DEBUG_ERROR("Could not write into file \"%s\"", quarantine->filename);
+            g_errno = ERROR_FILE_CREATION;
+            return false;
+        }
+        quarantine->offset++;
+    }
+
+    quarantine->records++;
+    if ((size_t) error < QUARANTINE_ERROR_CLASSES)
+        quarantine->counts[error]++;
+
+    return true;
+}
+
+bool quarantine_sync(quarantine_t *quarantine)
+{
+    if (quarantine == NULL || quarantine->fp == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    if (fflush(quarantine->fp) != 0 || fdatasync(fileno(quarantine->fp)) != 0)
+    {
+        DEBUG_ERROR("Could not sync file \"%s\"", quarantine->filename);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+
+    return true;
+}
+
+void quarantine_report(const quarantine_t *quarantine)
+{
+    if (quarantine == NULL)
+        return;
+
+    if (quarantine->records == 0)
+    {
+        DEBUG_INFO("No record was quarantined");
+        return;
+    }
+
+    DEBUG_WARN("Quarantined %zu records into \"%s\"", quarantine->records, quarantine->filename);
+    for (size_t i = 0; i < QUARANTINE_ERROR_CLASSES; i++)
+    {
+        if (quarantine->counts[i] != 0)
+            DEBUG_WARN("  %zu x error %zu (%s)", quarantine->counts[i], i, error_string((error_e) i));
+    }
+}
+
+bool quarantine_close(quarantine_t *quarantine)
+{
+    if (quarantine == NULL || quarantine->fp == NULL)
+        return true;
+
+    if (fclose(quarantine->fp) != 0)
+    {
+        DEBUG_ERROR("Could not close file \"%s\"", quarantine->filename);
+        quarantine->fp = NULL;
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+    quarantine->fp = NULL;
+
+    return true;
+}
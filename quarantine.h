@@ -0,0 +1,79 @@
+#ifndef QUARANTINE_H__
+#define QUARANTINE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "errors.h"
+
+#define QUARANTINE_ERROR_CLASSES    (size_t)(ERROR_INVALID_HEX + 1)     ///< One counter per error_e value
+
+/**
+ * @brief File collecting the records a batch run could not process, and how many failed per error
+ */
+typedef struct quarantine_s {
+    const char *filename;                       ///< The quarantine file
+    FILE *fp;                                   ///< The opened quarantine file
+    size_t offset;                              ///< Bytes written into the file so far
+    size_t records;                             ///< Records quarantined by this run
+    size_t counts[QUARANTINE_ERROR_CLASSES];    ///< Records quarantined by this run, per error code
+} quarantine_t;
+
+/**
+ * @brief Open the quarantine file
+ *
+ * @param[out] quarantine The quarantine to be initialized
+ * @param[in] filename The quarantine file
+ * @param[in] offset Size the file is cut to before appending (0 starts a new file)
+ *
+ * @retval True if success; false otherwise
+ */
+bool quarantine_open(quarantine_t *quarantine, const char *filename, size_t offset);
+
+/**
+ * @brief Append a failing record to the quarantine file
+ *
+ * A "record=N offset=O error=E (description)" line is written, followed
+ * by the record bytes as they were read, so the file stays readable as
+ * input once the header lines are filtered out.
+ *
+ * @param[in,out] quarantine The quarantine
+ * @param[in] record Index of the record in the input
+ * @param[in] offset Offset of the record in the (decompressed) input
+ * @param[in] error Why the record failed
+ * @param[in] data The record bytes
+ * @param[in] size The size of @p data buffer
+ *
+ * @retval True if success; false otherwise
+ */
+bool quarantine_add(quarantine_t *quarantine, size_t record, size_t offset, error_e error,
+                    const char *data, size_t size);
+
+/**
+ * @brief Make sure every record quarantined so far is on disk
+ *
+ * @param[in,out] quarantine The quarantine
+ *
+ * @retval True if success; false otherwise
+ */
+bool quarantine_sync(quarantine_t *quarantine);
+
+/**
+ * @brief Print how many records were quarantined, per error code
+ *
+ * @param[in] quarantine The quarantine
+ */
+void quarantine_report(const quarantine_t *quarantine);
+
+/**
+ * @brief Close the quarantine file
+ *
+ * @param[in,out] quarantine The quarantine
+ *
+ * @retval True if success; false otherwise
+ */
+bool quarantine_close(quarantine_t *quarantine);
+
+#endif /* QUARANTINE_H__ */
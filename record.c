@@ -0,0 +1,276 @@
+#include <string.h>
+
+#include "record.h"
+#include "message.h"
+
+/**
+ * @brief Classes of input bytes, the columns of the transition table
+ */
+typedef enum record_class_e {
+    RECORD_CLASS_OTHER,     ///< Anything not listed below
+    RECORD_CLASS_HEX,       ///< Hex digit that is not a keyword letter
+    RECORD_CLASS_A,         ///< 'a' (hex digit and letter of "mask=")
+    RECORD_CLASS_E,         ///< 'e' (hex digit and letter of "mess=")
+    RECORD_CLASS_M,         ///< 'm'
+    RECORD_CLASS_S,         ///< 's'
+    RECORD_CLASS_K,         ///< 'k'
+    RECORD_CLASS_EQUAL,     ///< '='
+    RECORD_CLASS_SPACE,     ///< ' ', '\t' and '\r'
+    RECORD_CLASS_NEWLINE,   ///< '\n'
+    RECORD_CLASS_COUNT,
+} record_class_e;
+
+/**
+ * @brief States of the recognizer, the rows of the transition table
+ */
+typedef enum record_state_e {
+    RECORD_STATE_BLANK,         ///< Before the record, skipping empty lines
+    RECORD_STATE_MESS_M,        ///< Read "m"
+    RECORD_STATE_MESS_E,        ///< Read "me"
+    RECORD_STATE_MESS_S,        ///< Read "mes"
+    RECORD_STATE_MESS_SS,       ///< Read "mess"
+    RECORD_STATE_MESS_HEX,      ///< In the message payload
+    RECORD_STATE_MESS_SPACE,    ///< In the white space after the message payload
+    RECORD_STATE_MASK_START,    ///< At the start of the mask line
+    RECORD_STATE_MASK_M,        ///< Read "m"
+    RECORD_STATE_MASK_A,        ///< Read "ma"
+    RECORD_STATE_MASK_S,        ///< Read "mas"
+    RECORD_STATE_MASK_K,        ///< Read "mask"
+    RECORD_STATE_MASK_HEX,      ///< In the mask payload
+    RECORD_STATE_MASK_SPACE,    ///< In the white space after the mask payload
+    RECORD_STATE_DONE,          ///< The new line ending the record was read
+    RECORD_STATE_FAIL_KEYWORD,  ///< RECORD_ERROR_KEYWORD
+    RECORD_STATE_FAIL_HEX,      ///< RECORD_ERROR_HEX
+    RECORD_STATE_FAIL_TRAILING, ///< RECORD_ERROR_TRAILING
+    RECORD_STATE_COUNT,
+} record_state_e;
+
+#define FK  RECORD_STATE_FAIL_KEYWORD
+#define FH  RECORD_STATE_FAIL_HEX
+#define FT  RECORD_STATE_FAIL_TRAILING
+
+/**
+ * @brief Row of the transition table, one next state per byte class
+ */
+#define RECORD_ROW(other, hex, a, e, m, s, k, equal, space, newline) \
+    { other, hex, a, e, m, s, k, equal, space, newline }
+
+static const uint8_t g_transitions[RECORD_STATE_COUNT][RECORD_CLASS_COUNT] = {
+    /*                                      other hex a   e   m   s   k   =   ws  \n */
+    [RECORD_STATE_BLANK]       = RECORD_ROW(FK, FK, FK, FK, RECORD_STATE_MESS_M, FK, FK, FK,
+                                            RECORD_STATE_BLANK, RECORD_STATE_BLANK),
+    [RECORD_STATE_MESS_M]      = RECORD_ROW(FK, FK, FK, RECORD_STATE_MESS_E, FK, FK, FK, FK, FK, FK),
+    [RECORD_STATE_MESS_E]      = RECORD_ROW(FK, FK, FK, FK, FK, RECORD_STATE_MESS_S, FK, FK, FK, FK),
+    [RECORD_STATE_MESS_S]      = RECORD_ROW(FK, FK, FK, FK, FK, RECORD_STATE_MESS_SS, FK, FK, FK, FK),
+    [RECORD_STATE_MESS_SS]     = RECORD_ROW(FK, FK, FK, FK, FK, FK, FK, RECORD_STATE_MESS_HEX, FK, FK),
+    [RECORD_STATE_MESS_HEX]    = RECORD_ROW(FH, RECORD_STATE_MESS_HEX, RECORD_STATE_MESS_HEX, RECORD_STATE_MESS_HEX,
+                                            FH, FH, FH, FH,
+                                            RECORD_STATE_MESS_SPACE, RECORD_STATE_MASK_START),
+    [RECORD_STATE_MESS_SPACE]  = RECORD_ROW(FT, FT, FT, FT, FT, FT, FT, FT,
+                                            RECORD_STATE_MESS_SPACE, RECORD_STATE_MASK_START),
+    [RECORD_STATE_MASK_START]  = RECORD_ROW(FK, FK, FK, FK, RECORD_STATE_MASK_M, FK, FK, FK, FK, FK),
+    [RECORD_STATE_MASK_M]      = RECORD_ROW(FK, FK, RECORD_STATE_MASK_A, FK, FK, FK, FK, FK, FK, FK),
+    [RECORD_STATE_MASK_A]      = RECORD_ROW(FK, FK, FK, FK, FK, RECORD_STATE_MASK_S, FK, FK, FK, FK),
+    [RECORD_STATE_MASK_S]      = RECORD_ROW(FK, FK, FK, FK, FK, FK, RECORD_STATE_MASK_K, FK, FK, FK),
+    [RECORD_STATE_MASK_K]      = RECORD_ROW(FK, FK, FK, FK, FK, FK, FK, RECORD_STATE_MASK_HEX, FK, FK),
+    [RECORD_STATE_MASK_HEX]    = RECORD_ROW(FH, RECORD_STATE_MASK_HEX, RECORD_STATE_MASK_HEX, RECORD_STATE_MASK_HEX,
+                                            FH, FH, FH, FH,
+                                            RECORD_STATE_MASK_SPACE, RECORD_STATE_DONE),
+    [RECORD_STATE_MASK_SPACE]  = RECORD_ROW(FT, FT, FT, FT, FT, FT, FT, FT,
+                                            RECORD_STATE_MASK_SPACE, RECORD_STATE_DONE),
+};
+
+#undef FK
+#undef FH
+#undef FT
+
+static const uint8_t g_classes[256] = {
+    ['0' ... '9'] = RECORD_CLASS_HEX,
+    ['A' ... 'F'] = RECORD_CLASS_HEX,
+    ['b' ... 'd'] = RECORD_CLASS_HEX,
+    ['f']         = RECORD_CLASS_HEX,
+    ['a']         = RECORD_CLASS_A,
+    ['e']         = RECORD_CLASS_E,
+    ['m']         = RECORD_CLASS_M,
+    ['s']         = RECORD_CLASS_S,
+    ['k']         = RECORD_CLASS_K,
+    ['=']         = RECORD_CLASS_EQUAL,
+    [' ']         = RECORD_CLASS_SPACE,
+    ['\t']        = RECORD_CLASS_SPACE,
+    ['\r']        = RECORD_CLASS_SPACE,
+    ['\n']        = RECORD_CLASS_NEWLINE,
+};
+
+static uint8_t record_nibble(char c)
+{
+    if (c >= '0' && c <= '9')
+        return (uint8_t)(c - '0');
+
+    if (c >= 'a' && c <= 'f')
+        return (uint8_t)(c - 'a' + 10);
+
+    return (uint8_t)(c - 'A' + 10);
+}
+
+static bool record_fail(const char *src, const char *at, record_error_e error, record_token_t *token)
+{
+    token->error = error;
+    token->offset = (size_t)(at - src);
+
+    return false;
+}
+
+bool record_scan(const char *src, size_t size, bool final, record_token_t *token)
+{
+    uint8_t state = RECORD_STATE_BLANK;
+    uint8_t next = RECORD_STATE_BLANK;
+    size_t message_begin = 0;
+    size_t message_end = 0;
+    size_t mask_begin = 0;
+    size_t mask_end = 0;
+    size_t length = 0;
+    size_t pos = 0;
+
+    if (src == NULL || token == NULL)
+        return false;
+
+    memset(token, 0, sizeof(*token));
+
+    for (pos = 0; pos < size && state < RECORD_STATE_DONE; pos++)
+    {
+        next = g_transitions[state][g_classes[(uint8_t) src[pos]]];
+
+        if (next != state)
+        {
+            if (next == RECORD_STATE_MESS_HEX)
+                message_begin = pos + 1;
+            else if (state == RECORD_STATE_MESS_HEX)
+                message_end = pos;
+            else if (next == RECORD_STATE_MASK_HEX)
+                mask_begin = pos + 1;
+            else if (state == RECORD_STATE_MASK_HEX)
+                mask_end = pos;
+        }
+
+        state = next;
+    }
+
+    switch (state)
+    {
+        case RECORD_STATE_DONE:
+            break;
+
+        case RECORD_STATE_FAIL_KEYWORD:
+            return record_fail(src, &src[pos - 1], RECORD_ERROR_KEYWORD, token);
+
+        case RECORD_STATE_FAIL_HEX:
+            return record_fail(src, &src[pos - 1], RECORD_ERROR_HEX, token);
+
+        case RECORD_STATE_FAIL_TRAILING:
+            return record_fail(src, &src[pos - 1], RECORD_ERROR_TRAILING, token);
+
+        case RECORD_STATE_MASK_HEX:
+            mask_end = pos;
+            /* fall through */
+
+        case RECORD_STATE_MASK_SPACE:
+            if (final == true)
+                break;
+            return record_fail(src, &src[pos], RECORD_ERROR_TRUNCATED, token);
+
+        case RECORD_STATE_BLANK:
+            if (final == true)
+                return record_fail(src, &src[pos], RECORD_ERROR_EMPTY, token);
+            return record_fail(src, &src[pos], RECORD_ERROR_TRUNCATED, token);
+
+        case RECORD_STATE_MESS_M:
+        case RECORD_STATE_MESS_E:
+        case RECORD_STATE_MESS_S:
+        case RECORD_STATE_MESS_SS:
+        case RECORD_STATE_MESS_HEX:
+        case RECORD_STATE_MESS_SPACE:
+        case RECORD_STATE_MASK_START:
+        case RECORD_STATE_MASK_M:
+        case RECORD_STATE_MASK_A:
+        case RECORD_STATE_MASK_S:
+        case RECORD_STATE_MASK_K:
+        case RECORD_STATE_COUNT:
+        default:
+            return record_fail(src, &src[pos], RECORD_ERROR_TRUNCATED, token);
+    }
+
+    token->message = &src[message_begin];
+    token->message_size = message_end - message_begin;
+    token->mask = &src[mask_begin];
+    token->mask_size = mask_end - mask_begin;
+    token->size = pos;
+
+    if (token->message_size < TYPE_HEX_LENGTH + LENGTH_HEX_LENGTH)
+        return record_fail(src, token->message, RECORD_ERROR_LENGTH, token);
+
+    length = (size_t)(record_nibble(token->message[TYPE_HEX_LENGTH]) << 4 |
+                      record_nibble(token->message[TYPE_HEX_LENGTH + 1]));
+    if (token->message_size != TYPE_HEX_LENGTH + LENGTH_HEX_LENGTH + length * ASCII_HEX_LENGTH)
+        return record_fail(src, token->message, RECORD_ERROR_LENGTH, token);
+
+    if (token->mask_size != MASK_HEX_LENGTH)
+        return record_fail(src, token->mask, RECORD_ERROR_MASK, token);
+
+    return true;
+}
+
+error_e record_error_code(record_error_e error)
+{
+    switch (error)
+    {
+        case RECORD_ERROR_NONE:
+            return ERROR_NO_ERROR;
+
+        case RECORD_ERROR_HEX:
+            return ERROR_INVALID_HEX;
+
+        case RECORD_ERROR_LENGTH:
+        case RECORD_ERROR_MASK:
+            return ERROR_LENGTH;
+
+        case RECORD_ERROR_KEYWORD:
+        case RECORD_ERROR_TRAILING:
+        case RECORD_ERROR_TRUNCATED:
+        case RECORD_ERROR_EMPTY:
+        default:
+            return ERROR_DATA_NOT_EXPECTED;
+    }
+}
+
+const char *record_error_string(record_error_e error)
+{
+    switch (error)
+    {
+        case RECORD_ERROR_NONE:
+            return "no error";
+
+        case RECORD_ERROR_KEYWORD:
+            return "expected \"mess=\" or \"mask=\"";
+
+        case RECORD_ERROR_HEX:
+            return "not a hex digit";
+
+        case RECORD_ERROR_TRAILING:
+            return "unexpected data after the payload";
+
+        case RECORD_ERROR_LENGTH:
+            return "message payload does not match its length";
+
+        case RECORD_ERROR_MASK:
+            return "mask payload has the wrong size";
+
+        case RECORD_ERROR_TRUNCATED:
+            return "record is truncated";
+
+        case RECORD_ERROR_EMPTY:
+            return "no record";
+
+        default:
+            return "unknown error";
+    }
+}
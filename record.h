@@ -0,0 +1,71 @@
+#ifndef RECORD_H__
+#define RECORD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "errors.h"
+
+/**
+ * @brief Why a buffer could not be recognized as a record
+ */
+typedef enum record_error_e {
+    RECORD_ERROR_NONE,      ///< A whole record was recognized
+    RECORD_ERROR_KEYWORD,   ///< A line does not start with the expected "mess=" or "mask=" keyword
+    RECORD_ERROR_HEX,       ///< A payload holds a byte that is not a hex digit
+    RECORD_ERROR_TRAILING,  ///< Something other than white space follows a payload
+    RECORD_ERROR_LENGTH,    ///< The message payload does not match its length field
+    RECORD_ERROR_MASK,      ///< The mask payload does not have the size of a mask
+    RECORD_ERROR_TRUNCATED, ///< The buffer ends in the middle of a record
+    RECORD_ERROR_EMPTY,     ///< The buffer holds nothing but empty lines
+} record_error_e;
+
+/**
+ * @brief Where the parts of a recognized record are, or where recognizing it failed
+ */
+typedef struct record_token_s {
+    const char *message;    ///< First hex digit after "mess=" (type, length, data and CRC)
+    size_t message_size;    ///< Number of hex digits in @p message
+    const char *mask;       ///< First hex digit after "mask="
+    size_t mask_size;       ///< Number of hex digits in @p mask
+    size_t size;            ///< Bytes of the buffer covered by the record, up to and including its last new line
+    record_error_e error;   ///< RECORD_ERROR_NONE if a record was recognized
+    size_t offset;          ///< Offset in the buffer of the byte where recognizing failed
+} record_token_t;
+
+/**
+ * @brief Recognize one "mess="/"mask=" record in a single forward pass over a buffer
+ *
+ * Empty lines before the record are skipped. Spaces, tabs and carriage
+ * returns after a payload are accepted, so CRLF input is read as is. The
+ * last line of the record may miss its new line only when @p final is set.
+ *
+ * @param[in] src The buffer
+ * @param[in] size The size of @p src buffer
+ * @param[in] final True if nothing follows @p src
+ * @param[out] token Where the record parts (or the error and its offset) are stored
+ *
+ * @retval True if a record was recognized; false otherwise
+ */
+bool record_scan(const char *src, size_t size, bool final, record_token_t *token);
+
+/**
+ * @brief Map a record error to the application error code
+ *
+ * @param[in] error The record error
+ *
+ * @retval Returns the matching error code
+ */
+error_e record_error_code(record_error_e error);
+
+/**
+ * @brief Get a human readable description of a record error
+ *
+ * @param[in] error The record error
+ *
+ * @retval Returns a static string
+ */
+const char *record_error_string(record_error_e error);
+
+#endif /* RECORD_H__ */
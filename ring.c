@@ -0,0 +1,337 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "ring.h"
+#include "errors.h"
+#include "debug.h"
+
+static size_t ring_mapping_size(size_t slots)
+{
+    return sizeof(ring_shared_t) + slots * (sizeof(ring_request_t) + sizeof(ring_response_t));
+}
+
+static void ring_map_slots(ring_t *ring)
+{
+    ring->slots = ring->shared->slots;
+    ring->requests = (ring_request_t *)(void *) &ring->shared[1];
+    ring->responses = (ring_response_t *)(void *) &ring->requests[ring->slots];
+}
+
+static bool ring_process_alive(uint32_t pid)
+{
+    /* EPERM: the process exists, it only belongs to another user */
+    return (pid != 0 && (kill((pid_t) pid, 0) == 0 || errno != ESRCH));
+}
+
+/**
+ * @brief Whether the object @p name can be removed: it does not exist, or it is a ring its processor is done with
+ */
+static bool ring_replaceable(const char *name)
+{
+    const ring_shared_t *shared = NULL;
+    struct stat status;
+    void *mapping = MAP_FAILED;
+    bool replaceable = false;
+    int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+
+    if (fd < 0)
+        return (errno == ENOENT);
+
+    if (fstat(fd, &status) == 0 && (size_t) status.st_size >= sizeof(ring_shared_t))
+        mapping = mmap(NULL, sizeof(ring_shared_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    /* only a ring of this layout tells whether its processor still runs */
+    shared = mapping;
+    if (memcmp(shared->magic, RING_MAGIC, sizeof(shared->magic)) == 0 && shared->version == RING_VERSION)
+        replaceable = (atomic_load(&shared->stopped) != 0 || ring_process_alive(shared->processor) == false);
+
+    munmap(mapping, sizeof(ring_shared_t));
+
+    return replaceable;
+}
+
+/**
+ * @brief Empty the rings left by a producer that exited without detaching
+ *
+ * The processor still answers the requests in flight; their responses
+ * belong to nobody and are dropped, and so are those the dead producer
+ * did not read. The processor publishes the responses of a batch before
+ * releasing its requests, so once the request ring is empty no stale
+ * response is left to come.
+ */
+static bool ring_reclaim(ring_t *ring)
+{
+    ring_shared_t *shared = ring->shared;
+    uint32_t doorbell = 0;
+
+    for (;;)
+    {
+        doorbell = ring_doorbell(&shared->requests);
+        if (ring_readable(&shared->requests) == 0)
+            break;
+
+        if (ring_stopped(ring) == true)
+            return false;
+
+        /* the processor may be waiting for room in the response ring */
+        ring_release(&shared->responses, ring_readable(&shared->responses));
+        ring_wait(&shared->requests, doorbell, RING_RECLAIM_SLEEP_MS);
+    }
+
+    ring_release(&shared->responses, ring_readable(&shared->responses));
+
+    return true;
+}
+
+bool ring_create(ring_t *ring, const char *name, size_t slots)
+{
+    void *mapping = NULL;
+    int fd = -1;
+
+    if (ring == NULL || name == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    if (slots == 0 || slots > RING_MAX_SLOTS || (slots & (slots - 1)) != 0)
+    {
+        DEBUG_ERROR("Ring slots must be a power of two up to %zu", RING_MAX_SLOTS);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    ring->name = name;
+    ring->size = ring_mapping_size(slots);
+
+    /* an object left behind by a processor that was killed holds nothing worth keeping */
+    if (ring_replaceable(name) == false)
+    {
+        DEBUG_ERROR("\"%s\" is served by a running processor or is not a ring", name);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+    shm_unlink(name);
+
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0 || ftruncate(fd, (off_t) ring->size) != 0)
+    {
+        DEBUG_ERROR("Could not create the shared memory object \"%s\"", name);
+        if (fd >= 0)
+        {
+            close(fd);
+            shm_unlink(name);
+        }
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+
+    mapping = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        DEBUG_ERROR("Could not map the shared memory object \"%s\"", name);
+        shm_unlink(name);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+
+    /* ftruncate() zeroed the object, so the counters already start at 0 */
+    ring->shared = mapping;
+    ring->owner = true;
+    ring->shared->version = RING_VERSION;
+    ring->shared->slots = (uint32_t) slots;
+    ring->shared->request_size = (uint32_t) sizeof(ring_request_t);
+    ring->shared->response_size = (uint32_t) sizeof(ring_response_t);
+    ring->shared->processor = (uint32_t) getpid();
+    ring_map_slots(ring);
+
+    /* the magic goes last, so a producer never sees a half initialized header */
+    atomic_thread_fence(memory_order_release);
+    memcpy(ring->shared->magic, RING_MAGIC, sizeof(ring->shared->magic));
+
+    return true;
+}
+
+bool ring_attach(ring_t *ring, const char *name)
+{
+    ring_shared_t *shared = NULL;
+    struct stat status;
+    uint32_t expected = 0;
+    uint32_t pid = (uint32_t) getpid();
+    void *mapping = MAP_FAILED;
+    int fd = -1;
+
+    if (ring == NULL || name == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    ring->name = name;
+
+    fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+    if (fd >= 0 && fstat(fd, &status) == 0 && (size_t) status.st_size >= sizeof(ring_shared_t))
+        mapping = mmap(NULL, (size_t) status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (fd >= 0)
+        close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        DEBUG_ERROR("No processor serves \"%s\"", name);
+        g_errno = ERROR_FILE_NOT_EXIST;
+        return false;
+    }
+
+    shared = mapping;
+    ring->shared = shared;
+    ring->size = (size_t) status.st_size;
+
+    if (memcmp(shared->magic, RING_MAGIC, sizeof(shared->magic)) != 0 || shared->version != RING_VERSION ||
+        shared->request_size != sizeof(ring_request_t) || shared->response_size != sizeof(ring_response_t) ||
+        ring_mapping_size(shared->slots) > ring->size)
+    {
+        DEBUG_ERROR("\"%s\" is not a ring of this version", name);
+        ring->shared = NULL;
+        munmap(mapping, ring->size);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+    ring_map_slots(ring);
+
+    /* the object of a processor that was killed is still there */
+    if (ring_stopped(ring) == true)
+    {
+        DEBUG_ERROR("No processor serves \"%s\"", name);
+        ring->shared = NULL;
+        munmap(mapping, ring->size);
+        g_errno = ERROR_FILE_NOT_EXIST;
+        return false;
+    }
+
+    if (atomic_compare_exchange_strong(&shared->producer, &expected, pid) == true)
+        return true;
+
+    /* on failure expected holds the pid of the producer; one that is gone left its side to take */
+    if (ring_process_alive(expected) == true ||
+        atomic_compare_exchange_strong(&shared->producer, &expected, pid) == false)
+    {
+        DEBUG_ERROR("\"%s\" already has a producer", name);
+        ring->shared = NULL;
+        munmap(mapping, ring->size);
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    DEBUG_WARN("Taking over \"%s\" from producer %" PRIu32 ", which exited without detaching", name, expected);
+    if (ring_reclaim(ring) == false)
+    {
+        DEBUG_ERROR("No processor serves \"%s\"", name);
+        ring_detach(ring);
+        g_errno = ERROR_FILE_NOT_EXIST;
+        return false;
+    }
+
+    return true;
+}
+
+bool ring_stopped(const ring_t *ring)
+{
+    return (atomic_load(&ring->shared->stopped) != 0 || ring_process_alive(ring->shared->processor) == false);
+}
+
+void ring_detach(ring_t *ring)
+{
+    if (ring == NULL || ring->shared == NULL)
+        return;
+
+    if (ring->owner == true)
+    {
+        /* a producer still attached sees it when it next waits */
+        atomic_store(&ring->shared->stopped, 1);
+        ring_publish(&ring->shared->responses, 0);
+        shm_unlink(ring->name);
+    }
+    else
+    {
+        atomic_store(&ring->shared->producer, 0);
+    }
+
+    munmap(ring->shared, ring->size);
+    ring->shared = NULL;
+}
+
+size_t ring_readable(ring_queue_t *queue)
+{
+    uint64_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+    return (size_t)(head - tail);
+}
+
+size_t ring_writable(ring_queue_t *queue, size_t slots)
+{
+    uint64_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    return slots - (size_t)(head - tail);
+}
+
+static void ring_notify(ring_queue_t *queue)
+{
+    /* pairs with the waiter counting itself in before it sleeps, see ring_wait() */
+    atomic_fetch_add(&queue->doorbell, 1);
+    if (atomic_load(&queue->waiters) != 0)
+        syscall(SYS_futex, &queue->doorbell, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+}
+
+void ring_publish(ring_queue_t *queue, size_t count)
+{
+    atomic_fetch_add_explicit(&queue->head, (uint64_t) count, memory_order_release);
+    ring_notify(queue);
+}
+
+void ring_release(ring_queue_t *queue, size_t count)
+{
+    atomic_fetch_add_explicit(&queue->tail, (uint64_t) count, memory_order_release);
+    ring_notify(queue);
+}
+
+uint32_t ring_doorbell(ring_queue_t *queue)
+{
+    return atomic_load(&queue->doorbell);
+}
+
+void ring_wait(ring_queue_t *queue, uint32_t doorbell, int timeout_ms)
+{
+    struct timespec timeout;
+
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+
+    /* a notify after this sees the waiter; one before it changed the doorbell, so the futex does not sleep */
+    atomic_fetch_add(&queue->waiters, 1);
+    syscall(SYS_futex, &queue->doorbell, FUTEX_WAIT, doorbell, &timeout, NULL, 0);
+    atomic_fetch_sub(&queue->waiters, 1);
+}
@@ -0,0 +1,187 @@
+#ifndef RING_H__
+#define RING_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "auriga.h"
+
+#define RING_MAGIC                  ("AURIGARG")                ///< First bytes of the shared memory object
+#define RING_VERSION                UINT32_C(2)                 ///< Layout of the shared memory object
+#define RING_DEFAULT_SLOTS          (size_t)UINT16_C(1024)      ///< Slots of each ring when none is given
+#define RING_MAX_SLOTS              (size_t)UINT32_C(1048576)   ///< Most slots of each ring
+#define RING_REQUEST_SIZE           (size_t)UINT16_C(1024)      ///< Largest record a request slot holds
+#define RING_RESPONSE_SIZE          AURIGA_OUTPUT_MAX_SIZE      ///< Largest output block a response slot holds
+#define RING_CACHE_LINE             (64)                        ///< Counters written by different sides are kept this far apart
+#define RING_FLAG_CORRECTED         UINT32_C(0x1)               ///< The record had a single-bit error that was repaired
+#define RING_RECLAIM_SLEEP_MS       (100)                       ///< Longest sleep while the rings of a dead producer are drained
+
+/**
+ * @brief Request slot: one record pushed by the producer
+ */
+typedef struct ring_request_s {
+    uint64_t id;                    ///< Chosen by the producer, echoed in the response
+    uint32_t size;                  ///< Bytes of @p data ("mess=" line followed by "mask=" line)
+    uint32_t reserved;              ///< Zero
+    char data[RING_REQUEST_SIZE];   ///< The record
+} ring_request_t;
+
+/**
+ * @brief Response slot: the outcome of one request, in request order
+ */
+typedef struct ring_response_s {
+    uint64_t id;                    ///< Id of the request
+    uint32_t size;                  ///< Bytes of @p data (0 if the record failed)
+    uint32_t error;                 ///< An error_e; ERROR_NO_ERROR if the record was processed
+    uint32_t flags;                 ///< RING_FLAG_* bits
+    uint32_t reserved;              ///< Zero
+    char data[RING_RESPONSE_SIZE];  ///< The output block, as the batch mode writes it
+} ring_response_t;
+
+/**
+ * @brief Single producer, single consumer queue of slots, living in the shared memory object
+ *
+ * The writer fills the slots from @p head on and then moves @p head; the
+ * reader reads the slots from @p tail on and then moves @p tail. Each
+ * counter is only written by one side, so no lock nor compare-and-swap
+ * is needed. A side that has to wait sleeps on @p doorbell with a futex,
+ * and is only woken when it said so in @p waiters, so the other side
+ * makes no system call while nobody sleeps.
+ */
+typedef struct ring_queue_s {
+    _Alignas(RING_CACHE_LINE) _Atomic uint64_t head;    ///< Slots ever published by the writer
+    _Alignas(RING_CACHE_LINE) _Atomic uint64_t tail;    ///< Slots ever released by the reader
+    _Alignas(RING_CACHE_LINE) _Atomic uint32_t doorbell;    ///< Futex word, bumped when @p head or @p tail moves
+    _Atomic uint32_t waiters;                           ///< Sides sleeping on @p doorbell
+} ring_queue_t;
+
+/**
+ * @brief Start of the shared memory object, followed by the request slots and then the response slots
+ */
+typedef struct ring_shared_s {
+    char magic[8];                  ///< RING_MAGIC, not NUL terminated
+    uint32_t version;               ///< RING_VERSION
+    uint32_t slots;                 ///< Slots of each ring (a power of two)
+    uint32_t request_size;          ///< sizeof(ring_request_t), so that producers can check the layout
+    uint32_t response_size;         ///< sizeof(ring_response_t), so that producers can check the layout
+    uint32_t processor;             ///< Pid of the processor
+    _Atomic uint32_t producer;      ///< Pid of the attached producer, 0 if none
+    _Atomic uint32_t stopped;       ///< 1 once the processor no longer serves the rings
+    ring_queue_t requests;          ///< From the producer to the processor
+    ring_queue_t responses;         ///< From the processor to the producer
+} ring_shared_t;
+
+/**
+ * @brief One side's view of the shared memory object
+ */
+typedef struct ring_s {
+    const char *name;               ///< Name of the shared memory object ("/name")
+    ring_shared_t *shared;          ///< The mapped object
+    size_t size;                    ///< Size of the mapping
+    ring_request_t *requests;       ///< Request slots
+    ring_response_t *responses;     ///< Response slots
+    size_t slots;                   ///< Slots of each ring
+    bool owner;                     ///< Created by this side, which removes it
+} ring_t;
+
+/**
+ * @brief Create the shared memory object, replacing a stale one of the same name (processor side)
+ *
+ * An object of the same name is only replaced if it is a ring whose
+ * processor stopped or no longer exists; otherwise the call fails and the
+ * object is left alone.
+ *
+ * @param[out] ring The ring to be initialized
+ * @param[in] name Name of the object, as given to shm_open() ("/name")
+ * @param[in] slots Slots of each ring, a power of two up to RING_MAX_SLOTS
+ *
+ * @retval True if success; false otherwise
+ */
+bool ring_create(ring_t *ring, const char *name, size_t slots);
+
+/**
+ * @brief Map the object created by a processor and claim its producer side
+ *
+ * The producer side of a producer that exited without detaching (killed,
+ * crashed) is taken over: the requests it left are answered by the
+ * processor and their responses dropped, so the rings start empty.
+ *
+ * @param[out] ring The ring to be initialized
+ * @param[in] name Name of the object, as given to shm_open() ("/name")
+ *
+ * @retval True if success; false if there is no such processor or it already has a producer
+ */
+bool ring_attach(ring_t *ring, const char *name);
+
+/**
+ * @brief Whether the processor no longer serves the rings: it detached, or its process is gone
+ *
+ * @param[in] ring The ring
+ *
+ * @retval True if the processor stopped; false while it runs
+ */
+bool ring_stopped(const ring_t *ring);
+
+/**
+ * @brief Unmap the object; the producer side is released and the processor side removes it
+ *
+ * @param[in,out] ring The ring
+ */
+void ring_detach(ring_t *ring);
+
+/**
+ * @brief Slots the reader of a queue can read, from its tail on
+ *
+ * @param[in] queue The queue
+ *
+ * @retval Returns how many slots were published and not released
+ */
+size_t ring_readable(ring_queue_t *queue);
+
+/**
+ * @brief Slots the writer of a queue can fill, from its head on
+ *
+ * @param[in] queue The queue
+ * @param[in] slots Slots of the queue
+ *
+ * @retval Returns how many slots are free
+ */
+size_t ring_writable(ring_queue_t *queue, size_t slots);
+
+/**
+ * @brief Make the next @p count slots filled by the writer visible to the reader
+ *
+ * @param[in,out] queue The queue
+ * @param[in] count Slots filled from the head on
+ */
+void ring_publish(ring_queue_t *queue, size_t count);
+
+/**
+ * @brief Give the next @p count slots read by the reader back to the writer
+ *
+ * @param[in,out] queue The queue
+ * @param[in] count Slots read from the tail on
+ */
+void ring_release(ring_queue_t *queue, size_t count);
+
+/**
+ * @brief Value of the doorbell of a queue, to be read before checking whether to wait
+ *
+ * @param[in] queue The queue
+ *
+ * @retval Returns the doorbell
+ */
+uint32_t ring_doorbell(ring_queue_t *queue);
+
+/**
+ * @brief Sleep until the queue changes after @p doorbell was read, or @p timeout_ms passes
+ *
+ * @param[in,out] queue The queue
+ * @param[in] doorbell What ring_doorbell() returned before the queue was found wanting
+ * @param[in] timeout_ms Longest sleep, in milliseconds
+ */
+void ring_wait(ring_queue_t *queue, uint32_t doorbell, int timeout_ms);
+
+#endif /* RING_H__ */
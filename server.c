@@ -0,0 +1,636 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "server.h"
+#include "auriga.h"
+#include "cache.h"
+#include "affinity.h"
+#include "errors.h"
+#include "debug.h"
+
+#define SERVER_ERROR_PREFIX         ("error: ")     ///< Start of the reply to a record that failed
+#define SERVER_ERROR_LINE_SIZE      (size_t)UINT8_C(128)    ///< Longest error reply
+
+/**
+ * @brief One client connection and the bytes it is waiting for
+ */
+typedef struct server_connection_s {
+    int fd;                                 ///< The connected socket
+    char *input;                            ///< Request bytes not yet processed (SERVER_READ_SIZE)
+    size_t input_size;                      ///< Bytes held in @p input
+    char *output;                           ///< Reply bytes not yet sent
+    size_t output_start;                    ///< First byte of @p output not yet sent
+    size_t output_size;                     ///< Bytes held in @p output
+    size_t output_capacity;                 ///< Bytes @p output can hold
+    uint32_t events;                        ///< Events the connection is registered for
+    bool closing;                           ///< The client is done sending; close once the replies are sent
+    struct server_connection_s *prev;       ///< Previous connection of the loop
+    struct server_connection_s *next;       ///< Next connection of the loop
+} server_connection_t;
+
+/**
+ * @brief One event loop, run by one worker thread
+ */
+typedef struct server_loop_s {
+    pthread_t thread;                       ///< The thread running the loop
+    int epoll_fd;                           ///< The event queue
+    int listen_fd;                          ///< The shared listening socket
+    bool busy_poll;                         ///< Spin on the queue instead of sleeping in it
+    uint32_t flags;                         ///< AURIGA_FLAG_* bits the records are processed with
+    size_t cache_entries;                   ///< Entries of @p cache; 0 disables it
+    cache_t *cache;                         ///< Cache owned by this loop (may be NULL)
+    server_connection_t *connections;       ///< Open connections of this loop
+    auriga_span_t spans[SERVER_BATCH_SIZE]; ///< Records of the batch being processed
+    auriga_result_t results[SERVER_BATCH_SIZE];    ///< Outcome of each record of the batch
+    uint64_t accepted;                      ///< Connections accepted
+    uint64_t requests;                      ///< Records answered
+    uint64_t failures;                      ///< Records answered with an error
+    int cpu;                                ///< CPU the loop is pinned to (AFFINITY_NONE if not pinned)
+    int node;                               ///< NUMA node the loop allocates from (AFFINITY_NONE if any)
+    error_e error;                          ///< Why the loop stopped, if it failed
+} server_loop_t;
+
+static volatile sig_atomic_t g_server_stop = 0;    ///< Set by SIGINT and SIGTERM
+
+static void server_on_signal(int signal_number)
+{
+    (void) signal_number;
+    g_server_stop = 1;
+}
+
+static void server_close(server_loop_t *loop, server_connection_t *connection)
+{
+    if (connection->prev != NULL)
+        connection->prev->next = connection->next;
+    else
+        loop->connections = connection->next;
+
+    if (connection->next != NULL)
+        connection->next->prev = connection->prev;
+
+    /* closing the socket also removes it from the queue */
+    close(connection->fd);
+    free(connection->input);
+    free(connection->output);
+    free(connection);
+}
+
+static bool server_reserve(server_connection_t *connection, size_t size)
+{
+    size_t capacity = connection->output_capacity;
+    char *output = NULL;
+
+    if (connection->output_start != 0)
+    {
+        memmove(connection->output, &connection->output[connection->output_start],
+                connection->output_size - connection->output_start);
+        connection->output_size -= connection->output_start;
+        connection->output_start = 0;
+    }
+
+    if (connection->output_size + size <= capacity)
+        return true;
+
+    while (connection->output_size + size > capacity)
+        capacity *= 2;
+
+    output = realloc(connection->output, capacity);
+    if (output == NULL)
+    {
+        DEBUG_ERROR("Could not grow the reply buffer to %zu bytes", capacity);
+        g_errno = ERROR_BUFFER_SIZE;
+        return false;
+    }
+
+    connection->output = output;
+    connection->output_capacity = capacity;
+
+    return true;
+}
+
+static size_t server_error_line(error_e error, char *dst, size_t dst_size)
+{
+    const char *description = error_string(error);
+    int length = 0;
+
+    if (description == NULL)
+        length = snprintf(dst, dst_size, "%sUnknown error value: %d\n", SERVER_ERROR_PREFIX, error);
+    else
+        length = snprintf(dst, dst_size, "%s%s\n", SERVER_ERROR_PREFIX, description);
+
+    if (length < 0)
+        return 0;
+
+    return ((size_t) length < dst_size) ? (size_t) length : dst_size - 1;
+}
+
+static bool server_answer(server_loop_t *loop, server_connection_t *connection, size_t count)
+{
+    char line[SERVER_ERROR_LINE_SIZE];
+    size_t written = 0;
+    size_t length = 0;
+    size_t extra = 0;
+    size_t end = 0;
+    char *base = NULL;
+
+    if (server_reserve(connection, count * AURIGA_OUTPUT_MAX_SIZE) == false)
+        return false;
+
+    base = &connection->output[connection->output_size];
+    written = auriga_process_batch(loop->spans, count, loop->flags, loop->cache,
+                                   base, count * AURIGA_OUTPUT_MAX_SIZE, loop->results);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (loop->results[i].error != ERROR_NO_ERROR)
+            extra += server_error_line(loop->results[i].error, line, sizeof(line));
+    }
+
+    /*
+     * Failing records wrote nothing. Their error lines are put in place
+     * from the last record backwards, so every block only moves forward.
+     */
+    if (extra != 0)
+    {
+        end = written + extra;
+        for (size_t i = count; i > 0; i--)
+        {
+            if (loop->results[i - 1].error == ERROR_NO_ERROR)
+            {
+                end -= loop->results[i - 1].size;
+                memmove(&base[end], &base[loop->results[i - 1].offset], loop->results[i - 1].size);
+            }
+            else
+            {
+                length = server_error_line(loop->results[i - 1].error, line, sizeof(line));
+                end -= length;
+                memcpy(&base[end], line, length);
+                loop->failures++;
+            }
+        }
+        written += extra;
+    }
+
+    connection->output_size += written;
+    loop->requests += count;
+
+    return true;
+}
+
+static bool server_process(server_loop_t *loop, server_connection_t *connection, bool final)
+{
+    size_t consumed = 0;
+    size_t count = 0;
+    size_t pos = 0;
+
+    do
+    {
+        count = auriga_split_records(&connection->input[pos], connection->input_size - pos, final,
+                                     loop->spans, SERVER_BATCH_SIZE, &consumed);
+        if (count != 0 && server_answer(loop, connection, count) == false)
+            return false;
+
+        pos += consumed;
+    } while (count == SERVER_BATCH_SIZE);
+
+    memmove(connection->input, &connection->input[pos], connection->input_size - pos);
+    connection->input_size -= pos;
+
+    if (connection->input_size == SERVER_READ_SIZE)
+    {
+        DEBUG_WARN("Closing a connection whose record does not fit in %zu bytes", SERVER_READ_SIZE);
+        return false;
+    }
+
+    return true;
+}
+
+static bool server_watch(server_loop_t *loop, server_connection_t *connection)
+{
+    struct epoll_event event;
+    uint32_t events = 0;
+    size_t pending = connection->output_size - connection->output_start;
+
+    if (pending != 0)
+        events |= EPOLLOUT;
+    if (pending < SERVER_WRITE_HIGH_WATER && connection->closing == false)
+        events |= EPOLLIN;
+
+    if (events == connection->events)
+        return true;
+
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.ptr = connection;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, connection->fd, &event) != 0)
+    {
+        DEBUG_ERROR("Could not update the events of a connection");
+        g_errno = ERROR_DATA_NOT_EXPECTED;
+        return false;
+    }
+
+    connection->events = events;
+
+    return true;
+}
+
+static bool server_flush(server_connection_t *connection)
+{
+    ssize_t sent = 0;
+
+    while (connection->output_start < connection->output_size)
+    {
+        sent = send(connection->fd, &connection->output[connection->output_start],
+                    connection->output_size - connection->output_start, MSG_NOSIGNAL);
+        if (sent > 0)
+            connection->output_start += (size_t) sent;
+        else if (sent < 0 && errno == EINTR)
+            continue;
+        else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        else
+            return false;
+    }
+
+    if (connection->output_start == connection->output_size)
+    {
+        connection->output_start = 0;
+        connection->output_size = 0;
+    }
+
+    return true;
+}
+
+static bool server_read(server_loop_t *loop, server_connection_t *connection)
+{
+    ssize_t received = 0;
+
+    while (connection->closing == false &&
+           connection->output_size - connection->output_start < SERVER_WRITE_HIGH_WATER)
+    {
+        received = recv(connection->fd, &connection->input[connection->input_size],
+                        SERVER_READ_SIZE - connection->input_size, 0);
+        if (received > 0)
+        {
+            connection->input_size += (size_t) received;
+            if (server_process(loop, connection, false) == false)
+                return false;
+        }
+        else if (received == 0)
+        {
+            connection->closing = true;
+            if (server_process(loop, connection, true) == false)
+                return false;
+        }
+        else if (errno == EINTR)
+        {
+            continue;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            break;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void server_accept(server_loop_t *loop)
+{
+    struct epoll_event event;
+    server_connection_t *connection = NULL;
+    int fd = -1;
+
+    while ((fd = accept4(loop->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+    {
+        connection = calloc(1, sizeof(*connection));
+        if (connection != NULL)
+        {
+            connection->fd = fd;
+            connection->input = malloc(SERVER_READ_SIZE);
+            connection->output_capacity = SERVER_BATCH_SIZE * AURIGA_OUTPUT_MAX_SIZE;
+            connection->output = malloc(connection->output_capacity);
+            connection->events = EPOLLIN;
+        }
+
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.ptr = connection;
+        if (connection == NULL || connection->input == NULL || connection->output == NULL ||
+            epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            DEBUG_WARN("Could not accept a connection");
+            if (connection != NULL)
+            {
+                free(connection->input);
+                free(connection->output);
+                free(connection);
+            }
+            close(fd);
+            continue;
+        }
+
+        connection->next = loop->connections;
+        if (loop->connections != NULL)
+            loop->connections->prev = connection;
+        loop->connections = connection;
+        loop->accepted++;
+    }
+}
+
+static void server_handle(server_loop_t *loop, server_connection_t *connection, uint32_t events)
+{
+    bool alive = true;
+
+    if ((events & EPOLLIN) != 0 || ((events & (EPOLLHUP | EPOLLERR)) != 0 && connection->closing == false))
+        alive = server_read(loop, connection);
+
+    /* all replies owed after this read go out with one call */
+    if (alive == true)
+        alive = server_flush(connection);
+
+    if (alive == true && connection->closing == true && connection->output_size == 0)
+        alive = false;
+
+    if (alive == true)
+        alive = server_watch(loop, connection);
+
+    if (alive == false)
+        server_close(loop, connection);
+}
+
+static void *server_loop_main(void *argument)
+{
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    server_loop_t *loop = argument;
+    int timeout = (loop->busy_poll == true) ? 0 : SERVER_SLEEP_MS;
+    int ready = 0;
+
+    /* the cache and the connection buffers are first written here, so they land on the loop node */
+    if (affinity_prefer_node(loop->node) == false)
+        DEBUG_WARN("The event loop buffers are not placed on node %d", loop->node);
+
+    if (loop->cache_entries != 0)
+    {
+        loop->cache = cache_create(loop->cache_entries);
+        if (loop->cache == NULL)
+        {
+            loop->error = ERROR_BUFFER_SIZE;
+            return NULL;
+        }
+    }
+
+    while (g_server_stop == 0)
+    {
+        ready = epoll_wait(loop->epoll_fd, events, SERVER_MAX_EVENTS, timeout);
+        if (ready < 0 && errno == EINTR)
+            continue;
+
+        if (ready < 0)
+        {
+            DEBUG_ERROR("Could not wait for events");
+            loop->error = ERROR_DATA_NOT_EXPECTED;
+            break;
+        }
+
+        for (int i = 0; i < ready; i++)
+        {
+            if (events[i].data.ptr == NULL)
+                server_accept(loop);
+            else
+                server_handle(loop, events[i].data.ptr, events[i].events);
+        }
+    }
+
+    while (loop->connections != NULL)
+        server_close(loop, loop->connections);
+
+    return NULL;
+}
+
+static int server_listen(const char *path)
+{
+    struct sockaddr_un address;
+    struct stat status;
+    int fd = -1;
+
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        DEBUG_ERROR("Socket path \"%s\" is too long", path);
+        g_errno = ERROR_BUFFER_SIZE;
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path, strlen(path));
+
+    /* a socket left behind by a previous run is replaced; one a server still listens on, or anything else, is kept */
+    if (lstat(path, &status) == 0 && S_ISSOCK(status.st_mode))
+    {
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, (const struct sockaddr *) &address, sizeof(address)) == 0)
+        {
+            DEBUG_ERROR("Another server is listening on \"%s\"", path);
+            close(fd);
+            g_errno = ERROR_FILE_CREATION;
+            return -1;
+        }
+
+        if (fd >= 0 && errno == ECONNREFUSED)
+            unlink(path);
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 ||
+        bind(fd, (const struct sockaddr *) &address, sizeof(address)) != 0 ||
+        listen(fd, SERVER_BACKLOG) != 0)
+    {
+        DEBUG_ERROR("Could not listen on \"%s\"", path);
+        g_errno = ERROR_FILE_CREATION;
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static bool server_start(server_loop_t *loops, size_t threads, bool pinned)
+{
+    pthread_attr_t attr;
+    size_t started = 0;
+    bool success = true;
+
+    if (threads == 1 && pinned == false)
+    {
+        server_loop_main(&loops[0]);
+        return true;
+    }
+
+    for (started = 0; started < threads; started++)
+    {
+        pthread_attr_init(&attr);
+        success = affinity_set_attr(&attr, loops[started].cpu);
+        if (success == true &&
+            pthread_create(&loops[started].thread, &attr, server_loop_main, &loops[started]) != 0)
+        {
+            DEBUG_ERROR("Could not start event loop %zu", started);
+            g_errno = ERROR_BUFFER_SIZE;
+            success = false;
+        }
+        pthread_attr_destroy(&attr);
+
+        if (success == false)
+            break;
+    }
+
+    /* a loop that could not start leaves the others running until a signal */
+    for (size_t i = 0; i < started; i++)
+        pthread_join(loops[i].thread, NULL);
+
+    return success;
+}
+
+static void server_report(const server_loop_t *loops, size_t threads)
+{
+    cache_stats_t total = {0};
+    cache_stats_t stats;
+    uint64_t accepted = 0;
+    uint64_t requests = 0;
+    uint64_t failures = 0;
+
+    for (size_t i = 0; i < threads; i++)
+    {
+        accepted += loops[i].accepted;
+        requests += loops[i].requests;
+        failures += loops[i].failures;
+
+        if (loops[i].cache != NULL)
+        {
+            cache_get_stats(loops[i].cache, &stats);
+            total.hits += stats.hits;
+            total.misses += stats.misses;
+        }
+    }
+
+    DEBUG_INFO("Served %" PRIu64 " records (%" PRIu64 " failed) over %" PRIu64 " connections",
+               requests, failures, accepted);
+
+    if (loops[0].cache != NULL)
+        DEBUG_INFO("Cache: %" PRIu64 " hits, %" PRIu64 " misses", total.hits, total.misses);
+}
+
+bool server_run(const options_t *options)
+{
+    struct sigaction action;
+    struct epoll_event event;
+    server_loop_t *loops = NULL;
+    affinity_t cpus;
+    size_t threads = 0;
+    bool success = false;
+    int listen_fd = -1;
+
+    if (options == NULL || options->socket == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    threads = options->threads;
+    cpus = options->worker_cpus;
+    if (options->numa == true)
+        affinity_group_by_node(&cpus);
+
+    listen_fd = server_listen(options->socket);
+    if (listen_fd < 0)
+        return false;
+
+    loops = calloc(threads, sizeof(*loops));
+    if (loops == NULL)
+    {
+        DEBUG_ERROR("Could not allocate the event loops");
+        g_errno = ERROR_BUFFER_SIZE;
+        goto cleanup;
+    }
+
+    for (size_t i = 0; i < threads; i++)
+        loops[i].epoll_fd = -1;
+
+    for (size_t i = 0; i < threads; i++)
+    {
+        loops[i].listen_fd = listen_fd;
+        loops[i].busy_poll = options->busy_poll;
+        loops[i].flags = (options->correct == true) ? AURIGA_FLAG_CORRECT_CRC : 0;
+        loops[i].cache_entries = options->cache_entries;
+        loops[i].cpu = affinity_cpu(&cpus, i);
+        loops[i].node = (options->numa == true) ? affinity_node(loops[i].cpu) : AFFINITY_NONE;
+
+        /* EPOLLEXCLUSIVE wakes a single loop per new connection */
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        event.data.ptr = NULL;
+        loops[i].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (loops[i].epoll_fd < 0 || epoll_ctl(loops[i].epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) != 0)
+        {
+            DEBUG_ERROR("Could not create the event queue of loop %zu", i);
+            g_errno = ERROR_DATA_NOT_EXPECTED;
+            goto cleanup;
+        }
+    }
+
+    /* no SA_RESTART, so that a loop sleeping in the queue wakes up at once */
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = server_on_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    DEBUG_INFO("Serving on \"%s\" with %zu event loop(s)%s", options->socket, threads,
+               (options->busy_poll == true) ? ", busy polling" : "");
+
+    success = server_start(loops, threads, cpus.count != 0);
+
+    for (size_t i = 0; i < threads; i++)
+    {
+        if (loops[i].error != ERROR_NO_ERROR)
+        {
+            g_errno = loops[i].error;
+            success = false;
+        }
+    }
+
+    server_report(loops, threads);
+
+cleanup:
+    for (size_t i = 0; i < threads && loops != NULL; i++)
+    {
+        cache_destroy(loops[i].cache);
+        if (loops[i].epoll_fd >= 0)
+            close(loops[i].epoll_fd);
+    }
+    free(loops);
+    close(listen_fd);
+    unlink(options->socket);
+
+    return success;
+}
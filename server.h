@@ -0,0 +1,37 @@
+#ifndef SERVER_H__
+#define SERVER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "options.h"
+
+#define SERVER_BACKLOG              (int)(128)                  ///< Connections waiting to be accepted
+#define SERVER_MAX_EVENTS           (int)(64)                   ///< Events taken from the queue at once
+#define SERVER_SLEEP_MS             (int)(100)                  ///< Longest sleep in the queue, so that a stop request is noticed
+#define SERVER_READ_SIZE            (size_t)UINT32_C(65536)     ///< Request bytes buffered per connection
+#define SERVER_BATCH_SIZE           (size_t)UINT16_C(64)        ///< Records processed in one call
+#define SERVER_WRITE_HIGH_WATER     (size_t)UINT32_C(1048576)   ///< Pending reply bytes above which a connection is no longer read
+
+/**
+ * @brief Answer records sent over a Unix domain socket until SIGINT or SIGTERM
+ *
+ * Clients write "mess="/"mask=" records to the socket, back to back and
+ * without waiting for the replies. Each record is answered, in order, with
+ * its output block (the same lines the batch mode writes to the output
+ * file), or with a single "error: <description>" line when it fails. The
+ * last line of a reply starts with "modified CRC-32: " or "error: ".
+ *
+ * Every worker thread runs its own epoll loop and accepts connections
+ * from the shared listening socket. Everything a connection has sent is
+ * read before its complete records are processed as one batch, and all
+ * replies it is owed are then written with a single call. With busy
+ * polling the loops spin on the queue instead of sleeping in it.
+ *
+ * @param[in] options The application options (socket, threads, cache, ...)
+ *
+ * @retval True if the server was stopped by a signal; false if it could not run
+ */
+bool server_run(const options_t *options);
+
+#endif /* SERVER_H__ */
@@ -0,0 +1,59 @@
+#include <string.h>
+
+#include "shard.h"
+#include "message.h"
+
+static bool shard_starts_with(const char *input, size_t size, size_t pos, const char *keyword, size_t keyword_size)
+{
+    return (size - pos >= keyword_size && memcmp(&input[pos], keyword, keyword_size) == 0);
+}
+
+static size_t shard_next_line(const char *input, size_t size, size_t pos)
+{
+    const char *newline = memchr(&input[pos], '\n', size - pos);
+
+    if (newline == NULL)
+        return size;
+
+    return (size_t)(newline - input) + 1;
+}
+
+size_t shard_resync(const char *input, size_t size, size_t pos)
+{
+    const size_t message_keyword_size = sizeof(g_message_leading_keyword) - 1;
+    const size_t mask_keyword_size = sizeof(g_mask_leading_keyword) - 1;
+    size_t next = 0;
+
+    if (input == NULL || pos >= size)
+        return size;
+
+    if (pos != 0 && input[pos - 1] != '\n')
+        pos = shard_next_line(input, size, pos);
+
+    while (pos < size)
+    {
+        next = shard_next_line(input, size, pos);
+
+        if (shard_starts_with(input, size, pos, g_message_leading_keyword, message_keyword_size) &&
+            shard_starts_with(input, size, next, g_mask_leading_keyword, mask_keyword_size))
+            return pos;
+
+        pos = next;
+    }
+
+    return size;
+}
+
+void shard_split(const char *input, size_t begin, size_t end, size_t count, size_t *bounds)
+{
+    const size_t step = (end - begin) / count;
+
+    bounds[0] = begin;
+    for (size_t i = 1; i < count; i++)
+    {
+        bounds[i] = shard_resync(input, end, begin + i * step);
+        if (bounds[i] < bounds[i - 1])
+            bounds[i] = bounds[i - 1];
+    }
+    bounds[count] = end;
+}
@@ -0,0 +1,39 @@
+#ifndef SHARD_H__
+#define SHARD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Find the first record boundary at or after @p pos
+ *
+ * A record boundary is the start of a "mess=" line directly followed by a
+ * "mask=" line. Hex payloads never contain '=', so such a line can only be
+ * the start of a record.
+ *
+ * @param[in] input The input buffer
+ * @param[in] size The size of @p input buffer
+ * @param[in] pos Where the search starts
+ *
+ * @retval Returns the offset of the boundary; @p size if there is none
+ */
+size_t shard_resync(const char *input, size_t size, size_t pos);
+
+/**
+ * @brief Cut input[begin, end) into @p count ranges of about the same size, each starting at a record boundary
+ *
+ * @p begin and @p end must be record boundaries (or the ends of the input).
+ * Ranges may be empty when there are fewer records than ranges. Together the
+ * ranges cover every byte of input[begin, end) exactly once, so nothing
+ * between two records is skipped.
+ *
+ * @param[in] input The input buffer
+ * @param[in] begin The start of the part to be cut
+ * @param[in] end The end of the part to be cut
+ * @param[in] count The number of ranges
+ * @param[out] bounds @p count + 1 offsets: range i is [bounds[i], bounds[i + 1])
+ */
+void shard_split(const char *input, size_t begin, size_t end, size_t count, size_t *bounds);
+
+#endif /* SHARD_H__ */
@@ -0,0 +1,217 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "auriga.h"
+#include "cache.h"
+#include "crc32.h"
+
+#define TEST_DISTINCT               (size_t)UINT8_C(40)         ///< Distinct records the input is built from
+#define TEST_RECORDS                (size_t)UINT16_C(20000)     ///< Records of the input
+#define TEST_RECORD_SIZE            (size_t)UINT16_C(600)       ///< Room for the longest record
+#define TEST_MIN_LENGTH             (size_t)UINT8_C(5)          ///< Shortest message length field (one data byte and the CRC)
+#define TEST_MAX_LENGTH             (size_t)UINT8_C(123)        ///< Longest message length field the parser takes
+#define TEST_WINDOW                 (size_t)UINT16_C(1000)      ///< Records per auriga_process_batch() call, as a batch worker would
+
+static const size_t g_capacities[] = { 1, 4, 8, 64, 4096 };    ///< Cache sizes compared with no cache
+
+static uint64_t g_seed = UINT64_C(0x2545F4914F6CDD1D);         ///< State of test_random()
+
+static uint32_t test_random(void)
+{
+    g_seed ^= g_seed << 13;
+    g_seed ^= g_seed >> 7;
+    g_seed ^= g_seed << 17;
+
+    return (uint32_t)(g_seed >> 32);
+}
+
+/**
+ * @brief Write a valid record of random type, length and data: "mess=TTLL<data><crc>\nmask=XXXXXXXX\n"
+ */
+static size_t test_make_record(char *dst, size_t dst_size)
+{
+    char data[UINT8_MAX];
+    size_t length = TEST_MIN_LENGTH + test_random() % (TEST_MAX_LENGTH - TEST_MIN_LENGTH + 1);
+    size_t size = length - 4;
+    uint32_t crc = 0;
+    int wrote = 0;
+
+    for (size_t i = 0; i < size; i++)
+        data[i] = (char)(test_random() & 0xFF);
+    crc = crc32_calculate(data, size);
+
+    wrote = snprintf(dst, dst_size, "mess=%02x%02x", (unsigned)(test_random() & 0xFF), (unsigned) length);
+    for (size_t i = 0; i < size; i++)
+        wrote += snprintf(&dst[wrote], dst_size - (size_t) wrote, "%02x", (unsigned)(uint8_t) data[i]);
+    wrote += snprintf(&dst[wrote], dst_size - (size_t) wrote, "%08x\nmask=%08x\n", crc, test_random());
+
+    return (size_t) wrote;
+}
+
+/**
+ * @brief Process every record, TEST_WINDOW at a time, into @p dst
+ */
+static size_t test_process(const auriga_span_t *spans, size_t count, cache_t *cache,
+                           char *dst, size_t dst_size, auriga_result_t *results)
+{
+    size_t pos = 0;
+
+    for (size_t first = 0; first < count; first += TEST_WINDOW)
+    {
+        size_t chunk = (count - first < TEST_WINDOW) ? count - first : TEST_WINDOW;
+        size_t written = auriga_process_batch(&spans[first], chunk, 0, cache, &dst[pos], dst_size - pos, &results[first]);
+
+        for (size_t i = first; i < first + chunk; i++)
+            results[i].offset += pos;
+        pos += written;
+    }
+
+    return pos;
+}
+
+static bool test_same_results(const auriga_result_t *results, const auriga_result_t *expected, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (results[i].error != expected[i].error || results[i].offset != expected[i].offset ||
+            results[i].size != expected[i].size || results[i].corrected != expected[i].corrected)
+            return false;
+    }
+
+    return true;
+}
+
+static int test_batch(void)
+{
+    static char distinct[TEST_DISTINCT][TEST_RECORD_SIZE];
+    size_t distinct_sizes[TEST_DISTINCT];
+    const size_t dst_size = TEST_RECORDS * AURIGA_OUTPUT_MAX_SIZE;
+    auriga_span_t *spans = calloc(TEST_RECORDS, sizeof(*spans));
+    auriga_result_t *expected_results = calloc(TEST_RECORDS, sizeof(*expected_results));
+    auriga_result_t *results = calloc(TEST_RECORDS, sizeof(*results));
+    char *expected = malloc(dst_size);
+    char *output = malloc(dst_size);
+    size_t expected_size = 0;
+    size_t size = 0;
+    size_t pick = 0;
+    cache_stats_t stats;
+    cache_t *cache = NULL;
+    int failures = 0;
+
+    if (spans == NULL || expected_results == NULL || results == NULL || expected == NULL || output == NULL)
+    {
+        fprintf(stderr, "FAIL: could not allocate the test buffers\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < TEST_DISTINCT; i++)
+        distinct_sizes[i] = test_make_record(distinct[i], sizeof(distinct[i]));
+
+    /* repeats close together, so that both copies of a record often fall in the same group of eight */
+    for (size_t i = 0; i < TEST_RECORDS; i++)
+    {
+        pick = test_random() % TEST_DISTINCT;
+        spans[i].data = distinct[pick];
+        spans[i].size = distinct_sizes[pick];
+    }
+
+    expected_size = test_process(spans, TEST_RECORDS, NULL, expected, dst_size, expected_results);
+    for (size_t i = 0; i < TEST_RECORDS; i++)
+    {
+        if (expected_results[i].error != ERROR_NO_ERROR)
+        {
+            fprintf(stderr, "FAIL: record %zu failed with error %d without a cache\n", i, expected_results[i].error);
+            return 1;
+        }
+    }
+
+    for (size_t c = 0; c < sizeof(g_capacities) / sizeof(g_capacities[0]); c++)
+    {
+        cache = cache_create(g_capacities[c]);
+        if (cache == NULL)
+        {
+            fprintf(stderr, "FAIL: could not create a cache of %zu entries\n", g_capacities[c]);
+            return 1;
+        }
+
+        size = test_process(spans, TEST_RECORDS, cache, output, dst_size, results);
+        cache_get_stats(cache, &stats);
+
+        if (size != expected_size || memcmp(output, expected, size) != 0 ||
+            test_same_results(results, expected_results, TEST_RECORDS) == false)
+        {
+            fprintf(stderr, "FAIL: output with a cache of %zu entries differs from the output without one\n",
+                    g_capacities[c]);
+            failures++;
+        }
+        else if (stats.hits == 0)
+        {
+            fprintf(stderr, "FAIL: a cache of %zu entries was never hit\n", g_capacities[c]);
+            failures++;
+        }
+
+        cache_destroy(cache);
+    }
+
+    free(spans);
+    free(expected_results);
+    free(results);
+    free(expected);
+    free(output);
+
+    return failures;
+}
+
+static int test_insert_twice(void)
+{
+    static const char key[] = "mess=0105aabbccdd\nmask=00000000\n";
+    const char *value = NULL;
+    size_t value_size = 0;
+    cache_stats_t stats;
+    cache_t *cache = cache_create(4);
+    int failures = 0;
+
+    if (cache == NULL)
+    {
+        fprintf(stderr, "FAIL: could not create a cache\n");
+        return 1;
+    }
+
+    cache_insert(cache, key, sizeof(key) - 1, "first", 5);
+    cache_insert(cache, key, sizeof(key) - 1, "second", 6);
+    cache_get_stats(cache, &stats);
+
+    if (stats.entries != 1 || stats.evictions != 0)
+    {
+        fprintf(stderr, "FAIL: inserting a record twice stored %zu entries\n", stats.entries);
+        failures++;
+    }
+
+    if (cache_lookup(cache, key, sizeof(key) - 1, &value, &value_size) == false ||
+        value_size != 6 || memcmp(value, "second", 6) != 0)
+    {
+        fprintf(stderr, "FAIL: inserting a record twice did not replace its output\n");
+        failures++;
+    }
+
+    cache_destroy(cache);
+
+    return failures;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    failures += test_insert_twice();
+    failures += test_batch();
+
+    if (failures != 0)
+        return 1;
+
+    printf("PASS: cached and uncached batch output are identical\n");
+
+    return 0;
+}
@@ -0,0 +1,240 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "crc32.h"
+#include "message.h"
+
+#define TEST_MAX_LENGTH             (size_t)UINT8_C(123)        ///< Longest message length field the parser takes
+#define TEST_RECORD_SIZE            (size_t)UINT16_C(600)       ///< Room for the longest record
+#define TEST_PAIRS                  (size_t)UINT16_C(20000)     ///< Random 2-bit errors tried per data size
+
+static const size_t g_exhaustive_sizes[] = { 1, 4, 64, CRC32_LOCATE_MAX_SIZE };  ///< Sizes whose every 2-bit error is tried
+
+static uint64_t g_seed = UINT64_C(0xD1B54A32D192ED03);         ///< State of test_random()
+
+static uint32_t test_random(void)
+{
+    g_seed ^= g_seed << 13;
+    g_seed ^= g_seed >> 7;
+    g_seed ^= g_seed << 17;
+
+    return (uint32_t)(g_seed >> 32);
+}
+
+/**
+ * @brief Syndrome of each single flipped bit of @p size bytes of data, then of each bit of the CRC
+ */
+static void test_syndromes(const char *data, size_t size, uint32_t *syndromes)
+{
+    char flipped[CRC32_LOCATE_MAX_SIZE];
+    uint32_t crc = crc32_calculate(data, size);
+
+    memcpy(flipped, data, size);
+    for (size_t bit = 0; bit < size * 8; bit++)
+    {
+        flipped[bit / 8] ^= (char)(1u << (bit % 8));
+        syndromes[bit] = crc32_calculate(flipped, size) ^ crc;
+        flipped[bit / 8] ^= (char)(1u << (bit % 8));
+    }
+
+    for (size_t bit = 0; bit < 32; bit++)
+        syndromes[size * 8 + bit] = UINT32_C(1) << bit;
+}
+
+/**
+ * @brief Every single-bit error is located at its bit; no 2-bit error is taken for one
+ */
+static int test_locate(void)
+{
+    static uint32_t syndromes[CRC32_LOCATE_MAX_SIZE * 8 + 32];
+    char data[CRC32_LOCATE_MAX_SIZE];
+    size_t bits = 0;
+    size_t bit = 0;
+    size_t first = 0;
+    size_t second = 0;
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = (char)(test_random() & 0xFF);
+
+    for (size_t size = 1; size <= CRC32_LOCATE_MAX_SIZE; size++)
+    {
+        bits = size * 8 + 32;
+        test_syndromes(data, size, syndromes);
+
+        for (size_t i = 0; i < bits; i++)
+        {
+            if (crc32_locate_error(size, syndromes[i], &bit) == false || bit != i)
+            {
+                fprintf(stderr, "FAIL: bit %zu of %zu bytes of data was not located\n", i, size);
+                failures++;
+            }
+        }
+
+        /* the CRC is linear: two flipped bits change it by the xor of their syndromes */
+        for (size_t i = 0; i < TEST_PAIRS; i++)
+        {
+            first = test_random() % bits;
+            second = test_random() % bits;
+            if (first != second && crc32_locate_error(size, syndromes[first] ^ syndromes[second], &bit) == true)
+            {
+                fprintf(stderr, "FAIL: bits %zu and %zu of %zu bytes of data were taken for bit %zu\n",
+                        first, second, size, bit);
+                failures++;
+            }
+        }
+    }
+
+    for (size_t s = 0; s < sizeof(g_exhaustive_sizes) / sizeof(g_exhaustive_sizes[0]); s++)
+    {
+        bits = g_exhaustive_sizes[s] * 8 + 32;
+        test_syndromes(data, g_exhaustive_sizes[s], syndromes);
+
+        for (first = 0; first < bits; first++)
+        {
+            for (second = first + 1; second < bits; second++)
+            {
+                if (crc32_locate_error(g_exhaustive_sizes[s], syndromes[first] ^ syndromes[second], &bit) == true)
+                {
+                    fprintf(stderr, "FAIL: bits %zu and %zu of %zu bytes of data were taken for bit %zu\n",
+                            first, second, g_exhaustive_sizes[s], bit);
+                    failures++;
+                }
+            }
+        }
+    }
+
+    return failures;
+}
+
+/**
+ * @brief Write a valid record of @p size data bytes: "mess=TTLL<data><crc>\nmask=XXXXXXXX\n"
+ */
+static size_t test_make_record(char *dst, size_t dst_size, const char *data, size_t size)
+{
+    int wrote = snprintf(dst, dst_size, "mess=01%02x", (unsigned)(size + CRC_SIZE));
+
+    for (size_t i = 0; i < size; i++)
+        wrote += snprintf(&dst[wrote], dst_size - (size_t) wrote, "%02x", (unsigned)(uint8_t) data[i]);
+    wrote += snprintf(&dst[wrote], dst_size - (size_t) wrote, "%08x\nmask=fefefefe\n", crc32_calculate(data, size));
+
+    return (size_t) wrote;
+}
+
+/**
+ * @brief Flip bit @p bit of the record text, counted as crc32_locate_error() counts it
+ *
+ * Bytes are written as two hex digits, high nibble first; the CRC follows
+ * the data and is written big-endian.
+ */
+static void test_flip(char *record, size_t size, size_t bit)
+{
+    static const char digits[] = "0123456789abcdef";
+    size_t byte = bit / 8;
+    size_t shift = bit % 8;
+    size_t pos = 0;
+    char *digit = NULL;
+    unsigned value = 0;
+
+    if (bit >= size * 8)
+    {
+        /* bit k of the CRC value, which is written most significant byte first */
+        byte = size + 3 - (bit - size * 8) / 8;
+        shift = (bit - size * 8) % 8;
+    }
+
+    pos = sizeof("mess=TTLL") - 1 + byte * 2 + ((shift < 4) ? 1 : 0);
+    digit = &record[pos];
+    value = (unsigned)(strchr(digits, *digit) - digits) ^ (1u << (shift % 4));
+    *digit = digits[value];
+}
+
+/**
+ * @brief Every single-bit error of a record is repaired when asked, and only then; 2-bit errors never are
+ */
+static int test_correct(void)
+{
+    char data[CRC32_LOCATE_MAX_SIZE];
+    char valid[TEST_RECORD_SIZE];
+    char record[TEST_RECORD_SIZE];
+    message_t expected;
+    message_t message;
+    size_t record_size = 0;
+    size_t bits = 0;
+    size_t first = 0;
+    size_t second = 0;
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = (char)(test_random() & 0xFF);
+
+    for (size_t size = 1; size + CRC_SIZE <= TEST_MAX_LENGTH; size++)
+    {
+        bits = size * 8 + 32;
+        record_size = test_make_record(valid, sizeof(valid), data, size);
+        if (message_parse(valid, record_size, false, &expected, NULL) == false)
+        {
+            fprintf(stderr, "FAIL: the valid record of %zu bytes of data failed with error %d\n", size, g_errno);
+            failures++;
+            continue;
+        }
+
+        for (size_t bit = 0; bit < bits; bit++)
+        {
+            memcpy(record, valid, record_size);
+            test_flip(record, size, bit);
+
+            g_errno = ERROR_NO_ERROR;
+            if (message_parse(record, record_size, false, &message, NULL) == true || g_errno != ERROR_CRC)
+            {
+                fprintf(stderr, "FAIL: bit %zu of %zu bytes of data was not reported without correction\n", bit, size);
+                failures++;
+            }
+
+            if (message_parse(record, record_size, true, &message, NULL) == false || message.corrected == false ||
+                memcmp(message.data, expected.data, size) != 0 || memcmp(message.crc, expected.crc, CRC_SIZE) != 0)
+            {
+                fprintf(stderr, "FAIL: bit %zu of %zu bytes of data was not repaired\n", bit, size);
+                failures++;
+            }
+        }
+
+        for (size_t i = 0; i < 64; i++)
+        {
+            first = test_random() % bits;
+            second = test_random() % bits;
+            if (first == second)
+                continue;
+
+            memcpy(record, valid, record_size);
+            test_flip(record, size, first);
+            test_flip(record, size, second);
+
+            g_errno = ERROR_NO_ERROR;
+            if (message_parse(record, record_size, true, &message, NULL) == true || g_errno != ERROR_CRC)
+            {
+                fprintf(stderr, "FAIL: bits %zu and %zu of %zu bytes of data were \"repaired\"\n", first, second, size);
+                failures++;
+            }
+        }
+    }
+
+    return failures;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    failures += test_locate();
+    failures += test_correct();
+
+    if (failures != 0)
+        return 1;
+
+    printf("PASS: every single-bit error is repaired and no 2-bit error is\n");
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "crc32.h"
+
+#define TEST_BUFFER_SIZE            (size_t)UINT32_C(1048583)   ///< Largest buffer, a prime so that the segments do not divide it
+#define TEST_MULTI_MAX_SIZE         (size_t)UINT8_C(255)        ///< Longest buffer given to crc32_calculate_multi()
+#define TEST_MULTI_ROUNDS           (size_t)UINT16_C(20000)     ///< Calls with random lanes, lengths and alignments
+
+static const size_t g_threads[] = { 2, 3, 4, 7, 8, 16, CRC32_PARALLEL_MAX_THREADS };   ///< Thread counts compared with the sequential CRC
+
+static uint64_t g_seed = UINT64_C(0x9E3779B97F4A7C15);         ///< State of test_random()
+
+static uint32_t test_random(void)
+{
+    g_seed ^= g_seed << 13;
+    g_seed ^= g_seed >> 7;
+    g_seed ^= g_seed << 17;
+
+    return (uint32_t)(g_seed >> 32);
+}
+
+/**
+ * @brief Compare crc32_calculate_parallel() with crc32_calculate() on the first @p size bytes of @p buffer
+ */
+static int test_size(const char *buffer, size_t size)
+{
+    uint32_t expected = crc32_calculate(buffer, size);
+    uint32_t crc = 0;
+    int failures = 0;
+
+    for (size_t t = 0; t < sizeof(g_threads) / sizeof(g_threads[0]); t++)
+    {
+        crc = crc32_calculate_parallel(buffer, size, g_threads[t]);
+        if (crc != expected)
+        {
+            fprintf(stderr, "FAIL: %zu bytes on %zu threads gave 0x%08" PRIx32 " instead of 0x%08" PRIx32 "\n",
+                    size, g_threads[t], crc, expected);
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+/**
+ * @brief Compare each lane of crc32_calculate_multi() with crc32_calculate() of the same buffer
+ */
+static int test_lanes(const char * const *srcs, const size_t *sizes, size_t count)
+{
+    uint32_t crcs[CRC32_MAX_LANES + 1];
+    int failures = 0;
+
+    /* the entry after the last lane must be left alone */
+    for (size_t lane = 0; lane <= CRC32_MAX_LANES; lane++)
+        crcs[lane] = UINT32_C(0xDEADBEEF);
+
+    crc32_calculate_multi(srcs, sizes, count, crcs);
+
+    for (size_t lane = 0; lane < count; lane++)
+    {
+        if (crcs[lane] != crc32_calculate(srcs[lane], sizes[lane]))
+        {
+            fprintf(stderr, "FAIL: lane %zu of %zu (%zu bytes at offset %zu mod 8) gave 0x%08" PRIx32 "\n",
+                    lane, count, sizes[lane], (size_t)((uintptr_t) srcs[lane] % 8), crcs[lane]);
+            failures++;
+        }
+    }
+
+    if (crcs[count] != UINT32_C(0xDEADBEEF))
+    {
+        fprintf(stderr, "FAIL: %zu lanes wrote past the last one\n", count);
+        failures++;
+    }
+
+    return failures;
+}
+
+static int test_multi(const char *buffer)
+{
+    const char *srcs[CRC32_MAX_LANES] = {0};
+    size_t sizes[CRC32_MAX_LANES] = {0};
+    size_t count = 0;
+    int failures = 0;
+
+    /* every lane count and length, lanes of the same length starting at different alignments */
+    for (count = 0; count <= CRC32_MAX_LANES; count++)
+    {
+        for (size_t size = 0; size <= TEST_MULTI_MAX_SIZE; size++)
+        {
+            for (size_t lane = 0; lane < count; lane++)
+            {
+                srcs[lane] = &buffer[lane * (TEST_MULTI_MAX_SIZE + 1) + lane];
+                sizes[lane] = size;
+            }
+            failures += test_lanes(srcs, sizes, count);
+        }
+    }
+
+    /* lanes of mixed lengths, so that they run out at different words */
+    for (size_t round = 0; round < TEST_MULTI_ROUNDS; round++)
+    {
+        count = test_random() % (CRC32_MAX_LANES + 1);
+        for (size_t lane = 0; lane < count; lane++)
+        {
+            srcs[lane] = &buffer[test_random() % (TEST_BUFFER_SIZE - TEST_MULTI_MAX_SIZE)];
+            sizes[lane] = test_random() % (TEST_MULTI_MAX_SIZE + 1);
+        }
+        failures += test_lanes(srcs, sizes, count);
+    }
+
+    return failures;
+}
+
+int main(void)
+{
+    char *buffer = malloc(TEST_BUFFER_SIZE);
+    size_t segments = 0;
+    int failures = 0;
+
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "FAIL: could not allocate the test buffer\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < TEST_BUFFER_SIZE; i++)
+        buffer[i] = (char)(test_random() & 0xFF);
+
+    /* around every multiple of the smallest segment: one more or one less segment, remainders of a few bytes */
+    for (segments = 1; segments * CRC32_PARALLEL_MIN_SEGMENT + 1 < TEST_BUFFER_SIZE; segments++)
+    {
+        failures += test_size(buffer, segments * CRC32_PARALLEL_MIN_SEGMENT - 1);
+        failures += test_size(buffer, segments * CRC32_PARALLEL_MIN_SEGMENT);
+        failures += test_size(buffer, segments * CRC32_PARALLEL_MIN_SEGMENT + 1);
+    }
+
+    failures += test_size(buffer, 0);
+    failures += test_size(buffer, 1);
+    failures += test_size(buffer, TEST_BUFFER_SIZE);
+
+    failures += test_multi(buffer);
+
+    free(buffer);
+
+    if (failures != 0)
+        return 1;
+
+    printf("PASS: parallel, multi-lane and sequential CRC-32 are identical\n");
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "record.h"
+
+#define TEST_MESS                   "mess=0105aabbccdd11"       ///< Message line of a valid record, without its new line
+#define TEST_MASK                   "mask=fefefefe"             ///< Mask line of a valid record, without its new line
+#define TEST_NONE                   (SIZE_MAX)                  ///< Field not checked
+
+/**
+ * @brief One input of record_scan() and what it must find
+ */
+typedef struct test_case_s {
+    const char *name;               ///< What the case checks
+    const char *input;              ///< The buffer (NUL terminated, the NUL not being part of it)
+    bool final;                     ///< Nothing follows the buffer
+    record_error_e error;           ///< Expected error
+    size_t offset;                  ///< Expected error offset, or size of the record if it is recognized
+    size_t message;                 ///< Expected offset of the message payload (TEST_NONE on error)
+    size_t message_size;            ///< Expected hex digits of the message payload
+    size_t mask;                    ///< Expected offset of the mask payload
+    size_t mask_size;               ///< Expected hex digits of the mask payload
+} test_case_t;
+
+static const test_case_t g_cases[] = {
+    { "valid record", TEST_MESS "\n" TEST_MASK "\n", false, RECORD_ERROR_NONE, 34, 5, 14, 25, 8 },
+    { "upper case hex", "mess=0105AABBCCDD11\nmask=FEFEFEFE\n", false, RECORD_ERROR_NONE, 34, 5, 14, 25, 8 },
+    { "CRLF", TEST_MESS "\r\n" TEST_MASK "\r\n", false, RECORD_ERROR_NONE, 36, 5, 14, 26, 8 },
+    { "empty lines before", "\n \r\n\t\n" TEST_MESS "\n" TEST_MASK "\n", false, RECORD_ERROR_NONE, 40, 11, 14, 31, 8 },
+    { "trailing white space", TEST_MESS " \t\n" TEST_MASK "  \n", false, RECORD_ERROR_NONE, 38, 5, 14, 27, 8 },
+    { "only the first record", TEST_MESS "\n" TEST_MASK "\n" TEST_MESS "\n", false, RECORD_ERROR_NONE, 34, 5, 14, 25, 8 },
+    { "no final new line, final", TEST_MESS "\n" TEST_MASK, true, RECORD_ERROR_NONE, 33, 5, 14, 25, 8 },
+    { "no final new line after white space, final", TEST_MESS "\n" TEST_MASK " \r", true,
+      RECORD_ERROR_NONE, 35, 5, 14, 25, 8 },
+    { "no final new line, more to come", TEST_MESS "\n" TEST_MASK, false, RECORD_ERROR_TRUNCATED, 33,
+      TEST_NONE, 0, 0, 0 },
+    { "truncated message", "mess=0105aa", true, RECORD_ERROR_TRUNCATED, 11, TEST_NONE, 0, 0, 0 },
+    { "truncated keyword", "mes", true, RECORD_ERROR_TRUNCATED, 3, TEST_NONE, 0, 0, 0 },
+    { "no mask line", TEST_MESS "\n", true, RECORD_ERROR_TRUNCATED, 20, TEST_NONE, 0, 0, 0 },
+    { "truncated mask keyword", TEST_MESS "\nmask", true, RECORD_ERROR_TRUNCATED, 24, TEST_NONE, 0, 0, 0 },
+    { "empty buffer", "", true, RECORD_ERROR_EMPTY, 0, TEST_NONE, 0, 0, 0 },
+    { "empty lines, final", "\n \n\r\n", true, RECORD_ERROR_EMPTY, 5, TEST_NONE, 0, 0, 0 },
+    { "empty lines, more to come", "\n \n\r\n", false, RECORD_ERROR_TRUNCATED, 5, TEST_NONE, 0, 0, 0 },
+    { "wrong first keyword", "mesz=0105aabbccdd11\n" TEST_MASK "\n", false, RECORD_ERROR_KEYWORD, 3,
+      TEST_NONE, 0, 0, 0 },
+    { "stray byte before the record", "x" TEST_MESS "\n" TEST_MASK "\n", false, RECORD_ERROR_KEYWORD, 0,
+      TEST_NONE, 0, 0, 0 },
+    { "wrong second keyword", TEST_MESS "\nmasc=fefefefe\n", false, RECORD_ERROR_KEYWORD, 23, TEST_NONE, 0, 0, 0 },
+    { "message line twice", TEST_MESS "\n" TEST_MESS "\n", false, RECORD_ERROR_KEYWORD, 21, TEST_NONE, 0, 0, 0 },
+    { "empty line inside the record", TEST_MESS "\n\n" TEST_MASK "\n", false, RECORD_ERROR_KEYWORD, 20,
+      TEST_NONE, 0, 0, 0 },
+    { "bad message hex", "mess=0105aabbccgd11\n" TEST_MASK "\n", false, RECORD_ERROR_HEX, 15, TEST_NONE, 0, 0, 0 },
+    { "bad mask hex", TEST_MESS "\nmask=fefefefz\n", false, RECORD_ERROR_HEX, 32, TEST_NONE, 0, 0, 0 },
+    { "data after the message", TEST_MESS " x\n" TEST_MASK "\n", false, RECORD_ERROR_TRAILING, 20,
+      TEST_NONE, 0, 0, 0 },
+    { "data after the mask", TEST_MESS "\n" TEST_MASK "\tx\n", false, RECORD_ERROR_TRAILING, 34, TEST_NONE, 0, 0, 0 },
+    { "length field too large", "mess=0106aabbccdd11\n" TEST_MASK "\n", false, RECORD_ERROR_LENGTH, 5,
+      TEST_NONE, 0, 0, 0 },
+    { "length field too small", "mess=0104aabbccdd11\n" TEST_MASK "\n", false, RECORD_ERROR_LENGTH, 5,
+      TEST_NONE, 0, 0, 0 },
+    { "no length field", "mess=01\n" TEST_MASK "\n", false, RECORD_ERROR_LENGTH, 5, TEST_NONE, 0, 0, 0 },
+    { "odd payload", "mess=0105aabbccdd1\n" TEST_MASK "\n", false, RECORD_ERROR_LENGTH, 5, TEST_NONE, 0, 0, 0 },
+    { "short mask", TEST_MESS "\nmask=fefefe\n", false, RECORD_ERROR_MASK, 25, TEST_NONE, 0, 0, 0 },
+    { "long mask", TEST_MESS "\nmask=fefefefe00\n", false, RECORD_ERROR_MASK, 25, TEST_NONE, 0, 0, 0 },
+    { "empty mask", TEST_MESS "\nmask=\n", false, RECORD_ERROR_MASK, 25, TEST_NONE, 0, 0, 0 },
+};
+
+static int test_case(const test_case_t *test)
+{
+    const char *src = test->input;
+    record_token_t token;
+    bool recognized = record_scan(src, strlen(src), test->final, &token);
+    size_t offset = (recognized == true) ? token.size : token.offset;
+
+    if (recognized != (test->error == RECORD_ERROR_NONE) || token.error != test->error || offset != test->offset)
+    {
+        fprintf(stderr, "FAIL: %s: got \"%s\" at %zu, expected \"%s\" at %zu\n", test->name,
+                record_error_string(token.error), offset, record_error_string(test->error), test->offset);
+        return 1;
+    }
+
+    if (test->message != TEST_NONE &&
+        ((size_t)(token.message - src) != test->message || token.message_size != test->message_size ||
+         (size_t)(token.mask - src) != test->mask || token.mask_size != test->mask_size))
+    {
+        fprintf(stderr, "FAIL: %s: payloads at %zu (%zu digits) and %zu (%zu digits)\n", test->name,
+                (size_t)(token.message - src), token.message_size, (size_t)(token.mask - src), token.mask_size);
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(g_cases) / sizeof(g_cases[0]); i++)
+        failures += test_case(&g_cases[i]);
+
+    if (failures != 0)
+        return 1;
+
+    printf("PASS: %zu record_scan() cases\n", sizeof(g_cases) / sizeof(g_cases[0]));
+
+    return 0;
+}
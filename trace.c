@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "trace.h"
+#include "errors.h"
+#include "debug.h"
+
+_Thread_local trace_ring_t *g_trace_ring = NULL;
+
+static const char *g_trace_stage_names[TRACE_STAGES] = {
+    [TRACE_STAGE_LOAD] = "load",
+    [TRACE_STAGE_VERIFY] = "verify",
+    [TRACE_STAGE_UPDATE] = "update",
+    [TRACE_STAGE_FORMAT] = "format",
+    [TRACE_STAGE_WRITE] = "write",
+};
+
+const char *trace_stage_name(uint8_t stage)
+{
+    if (stage >= TRACE_STAGES)
+        return "unknown";
+
+    return g_trace_stage_names[stage];
+}
+
+bool trace_open(trace_t *trace, size_t events)
+{
+    size_t capacity = 1;
+
+    if (trace == NULL || events == 0)
+    {
+        DEBUG_ERROR("Invalid parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    while (capacity < events)
+        capacity <<= 1;
+
+    memset(trace, 0, sizeof(*trace));
+    trace->events = capacity;
+
+    return true;
+}
+
+trace_ring_t *trace_ring(trace_t *trace, const char *name)
+{
+    trace_ring_t **rings = NULL;
+    trace_ring_t *ring = NULL;
+
+    if (trace == NULL || name == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return NULL;
+    }
+
+    rings = realloc(trace->rings, (trace->count + 1) * sizeof(*rings));
+    if (rings == NULL)
+    {
+        DEBUG_ERROR("Could not allocate the trace rings");
+        g_errno = ERROR_BUFFER_SIZE;
+        return NULL;
+    }
+    trace->rings = rings;
+
+    ring = calloc(1, sizeof(*ring));
+    if (ring != NULL)
+        ring->events = calloc(trace->events, sizeof(*ring->events));
+    if (ring == NULL || ring->events == NULL)
+    {
+        DEBUG_ERROR("Could not allocate %zu trace events", trace->events);
+        free(ring);
+        g_errno = ERROR_BUFFER_SIZE;
+        return NULL;
+    }
+
+    snprintf(ring->name, sizeof(ring->name), "%s", name);
+    ring->mask = trace->events - 1;
+    trace->rings[trace->count++] = ring;
+
+    return ring;
+}
+
+trace_ring_t *trace_switch(trace_ring_t *ring)
+{
+    trace_ring_t *previous = g_trace_ring;
+
+    g_trace_ring = ring;
+
+    return previous;
+}
+
+static bool trace_save_ring(const trace_ring_t *ring, FILE *fp)
+{
+    trace_ring_header_t header;
+    uint64_t capacity = (uint64_t) ring->mask + 1;
+    uint64_t first = 0;
+    size_t start = 0;
+    size_t count = 0;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.name, ring->name, sizeof(header.name));
+    header.events = (ring->head < capacity) ? ring->head : capacity;
+    header.dropped = ring->head - header.events;
+
+    if (fwrite(&header, sizeof(header), 1, fp) != 1)
+        return false;
+
+    /* oldest first: the part of the ring after the head, then the part before it */
+    first = ring->head - header.events;
+    start = (size_t)(first & ring->mask);
+    count = (size_t) header.events;
+    if (start + count > capacity)
+    {
+        if (fwrite(&ring->events[start], sizeof(ring->events[0]), (size_t) capacity - start, fp) != (size_t) capacity - start)
+            return false;
+        count -= (size_t) capacity - start;
+        start = 0;
+    }
+
+    return fwrite(&ring->events[start], sizeof(ring->events[0]), count, fp) == count;
+}
+
+bool trace_save(const trace_t *trace, const char *filename)
+{
+    trace_header_t header;
+    uint64_t dropped = 0;
+    bool success = true;
+    FILE *fp = NULL;
+
+    if (trace == NULL || filename == NULL)
+    {
+        DEBUG_ERROR("NULL parameter");
+        g_errno = ERROR_NULL_PARAMETER;
+        return false;
+    }
+
+    fp = fopen(filename, "w");
+    if (fp == NULL)
+    {
+        DEBUG_ERROR("Creating/opening \"%s\" file", filename);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.event_size = (uint32_t) sizeof(trace_event_t);
+    header.rings = (uint32_t) trace->count;
+
+    success = (fwrite(&header, sizeof(header), 1, fp) == 1);
+    for (size_t i = 0; i < trace->count && success == true; i++)
+    {
+        success = trace_save_ring(trace->rings[i], fp);
+        if (trace->rings[i]->head > trace->rings[i]->mask + 1)
+            dropped += trace->rings[i]->head - (trace->rings[i]->mask + 1);
+    }
+
+    if (fclose(fp) != 0)
+        success = false;
+
+    if (success == false)
+    {
+        DEBUG_ERROR("Could not write into file \"%s\"", filename);
+        g_errno = ERROR_FILE_CREATION;
+        return false;
+    }
+
+    if (dropped != 0)
+        DEBUG_WARN("%" PRIu64 " trace events were overwritten, raise --trace-events to keep them", dropped);
+
+    return true;
+}
+
+void trace_close(trace_t *trace)
+{
+    if (trace == NULL)
+        return;
+
+    for (size_t i = 0; i < trace->count; i++)
+    {
+        free(trace->rings[i]->events);
+        free(trace->rings[i]);
+    }
+
+    free(trace->rings);
+    memset(trace, 0, sizeof(*trace));
+}
@@ -0,0 +1,195 @@
+#ifndef TRACE_H__
+#define TRACE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+#define TRACE_MAGIC                 ("AURIGATR")                ///< First bytes of a trace file
+#define TRACE_VERSION               UINT32_C(1)                 ///< Layout of the trace file
+#define TRACE_NAME_SIZE             (size_t)UINT8_C(16)         ///< Size of the name of a ring, NUL included
+#define TRACE_MAX_LANES             (size_t)UINT8_C(8)          ///< Records whose index a ring keeps for message_*_batch()
+
+/**
+ * @brief Processing stages an event can cover
+ */
+typedef enum trace_stage_e {
+    TRACE_STAGE_LOAD = 0,   ///< Record scanned and decoded into a message_t
+    TRACE_STAGE_VERIFY,     ///< CRC of the received data checked
+    TRACE_STAGE_UPDATE,     ///< Modified message built and its CRC computed
+    TRACE_STAGE_FORMAT,     ///< Output block written (or copied from the cache)
+    TRACE_STAGE_WRITE,      ///< Output of a window committed to the output file
+    TRACE_STAGES,           ///< Number of stages
+} trace_stage_e;
+
+/**
+ * @brief One timed stage of one record (or of @p count consecutive ones), as stored in the trace file
+ */
+typedef struct trace_event_s {
+    uint64_t begin;         ///< Start, in nanoseconds of CLOCK_MONOTONIC
+    uint64_t end;           ///< End, in nanoseconds of CLOCK_MONOTONIC
+    uint64_t record;        ///< Index of the (first) record in the input
+    uint32_t count;         ///< Records covered by the event
+    uint8_t stage;          ///< A trace_stage_e
+    uint8_t reserved[3];    ///< Zero
+} trace_event_t;
+
+/**
+ * @brief Header of a trace file, followed by its rings
+ */
+typedef struct trace_header_s {
+    char magic[8];          ///< TRACE_MAGIC, not NUL terminated
+    uint32_t version;       ///< TRACE_VERSION
+    uint32_t event_size;    ///< sizeof(trace_event_t), so that readers can check the layout
+    uint32_t rings;         ///< Number of rings that follow
+    uint32_t reserved;      ///< Zero
+} trace_header_t;
+
+/**
+ * @brief Header of one ring in a trace file, followed by its @p events, oldest first
+ */
+typedef struct trace_ring_header_s {
+    char name[TRACE_NAME_SIZE]; ///< Name of the thread the ring was filled by
+    uint64_t events;            ///< Events that follow
+    uint64_t dropped;           ///< Older events overwritten because the ring was full
+} trace_ring_header_t;
+
+/**
+ * @brief Events of one thread; the oldest ones are overwritten once it is full
+ */
+typedef struct trace_ring_s {
+    char name[TRACE_NAME_SIZE];         ///< Name shown for the thread
+    trace_event_t *events;              ///< The ring
+    size_t mask;                        ///< Capacity of @p events minus one (a power of two)
+    uint64_t head;                      ///< Events ever recorded
+    uint64_t base;                      ///< Index in the input of the first record of the current call
+    uint64_t lanes[TRACE_MAX_LANES];    ///< Index in the input of the record in each lane of a message_*_batch() call
+} trace_ring_t;
+
+/**
+ * @brief Every ring of a run
+ */
+typedef struct trace_s {
+    trace_ring_t **rings;               ///< The rings, in creation order
+    size_t count;                       ///< Entries in @p rings
+    size_t events;                      ///< Capacity of each ring
+} trace_t;
+
+/**
+ * @brief Ring the calling thread records into; NULL when it is not traced
+ */
+extern _Thread_local trace_ring_t *g_trace_ring;
+
+/**
+ * @brief Current time, in nanoseconds of CLOCK_MONOTONIC
+ */
+static inline uint64_t trace_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * UINT64_C(1000000000) + (uint64_t) now.tv_nsec;
+}
+
+/**
+ * @brief Append an event to the ring of the calling thread
+ *
+ * @param[in] stage The stage the event covers
+ * @param[in] begin When the stage started, from trace_now()
+ * @param[in] record Index of the (first) record in the input
+ * @param[in] count Records covered by the event
+ */
+static inline void trace_record(trace_stage_e stage, uint64_t begin, uint64_t record, size_t count)
+{
+    trace_ring_t *ring = g_trace_ring;
+    trace_event_t *event = &ring->events[ring->head & ring->mask];
+
+    event->begin = begin;
+    event->end = trace_now();
+    event->record = record;
+    event->count = (uint32_t) count;
+    event->stage = (uint8_t) stage;
+    ring->head++;
+}
+
+/**
+ * @brief Start timing a stage: the time if the calling thread is traced; 0 otherwise
+ */
+#define TRACE_BEGIN()       ((g_trace_ring != NULL) ? trace_now() : UINT64_C(0))
+
+/**
+ * @brief Finish timing a stage started with TRACE_BEGIN(); no-op if the calling thread is not traced
+ */
+#define TRACE_END(stage, begin, record, count) \
+    do { if (g_trace_ring != NULL) trace_record((stage), (begin), (record), (count)); } while (0)
+
+/**
+ * @brief Index in the input of the record at the given position of the current call (0 if not traced)
+ */
+#define TRACE_RECORD(i)     ((g_trace_ring != NULL) ? g_trace_ring->base + (uint64_t)(i) : UINT64_C(0))
+
+/**
+ * @brief Index in the input of the record in the given lane of a message_*_batch() call (0 if not traced)
+ */
+#define TRACE_LANE(lane)    ((g_trace_ring != NULL) ? g_trace_ring->lanes[(lane)] : UINT64_C(0))
+
+/**
+ * @brief Name of a stage, as shown in the timeline
+ *
+ * @param[in] stage The stage
+ *
+ * @retval Returns the name; "unknown" for values out of range
+ */
+const char *trace_stage_name(uint8_t stage);
+
+/**
+ * @brief Prepare a trace whose rings hold @p events events each
+ *
+ * @param[out] trace The trace to be initialized
+ * @param[in] events Capacity of each ring, rounded up to a power of two
+ *
+ * @retval True if success; false otherwise
+ */
+bool trace_open(trace_t *trace, size_t events);
+
+/**
+ * @brief Create a ring; threads record into it once it is given to trace_switch()
+ *
+ * Not thread safe: rings are created before the threads using them start.
+ *
+ * @param[in,out] trace The trace
+ * @param[in] name Name shown for the thread (truncated to TRACE_NAME_SIZE - 1 characters)
+ *
+ * @retval Returns the ring; NULL otherwise
+ */
+trace_ring_t *trace_ring(trace_t *trace, const char *name);
+
+/**
+ * @brief Make the calling thread record into another ring
+ *
+ * @param[in] ring The ring to record into; NULL stops tracing the thread
+ *
+ * @retval Returns the ring the thread recorded into before
+ */
+trace_ring_t *trace_switch(trace_ring_t *ring);
+
+/**
+ * @brief Write every ring into a trace file, see trace_header_t
+ *
+ * @param[in] trace The trace
+ * @param[in] filename The trace file
+ *
+ * @retval True if success; false otherwise
+ */
+bool trace_save(const trace_t *trace, const char *filename);
+
+/**
+ * @brief Free the rings
+ *
+ * @param[in,out] trace The trace
+ */
+void trace_close(trace_t *trace);
+
+#endif /* TRACE_H__ */
@@ -5,7 +5,7 @@
 #include "utils.h"
 #include "debug.h"
 
-size_t utils_hex_to_bin(char *src, size_t src_size, char *dst, size_t dst_size)
+size_t utils_hex_to_bin(const char *src, size_t src_size, char *dst, size_t dst_size)
 {
     char temp[ASCII_HEX_LENGTH + 1] = {0};
     size_t i = 0;
@@ -37,26 +37,6 @@ size_t utils_hex_to_bin(char *src, size_t src_size, char *dst, size_t dst_size)
     return i;
 }
 
-size_t utils_bin_to_hex(char *src, size_t src_size, char *dst, size_t dst_size)
-{
-    size_t i = 0;
-    if (src_size * ASCII_HEX_LENGTH > dst_size)
-    {
-        g_errno = ERROR_BUFFER_SIZE;
-        return 0;
-    }
-
-    memset(dst, 0, dst_size);
-
-    for (i = 0; i < src_size; i++)
-    {
-        snprintf(dst, 3, "%02x", 0xff & src[i]);
-        dst+= 2;
-    }
-
-    return (i * ASCII_HEX_LENGTH);
-}
-
 void utils_apply_mask_on_tetrads(char *data, size_t size, uint32_t mask)
 {
     uint32_t *p;
@@ -81,40 +61,3 @@ void utils_apply_mask_on_tetrads(char *data, size_t size, uint32_t mask)
             p[i] = p[i] & mask;
     }
 }
-
-size_t utils_append_header_and_payload_into_buffer(char *dst,
-                                                   size_t dst_size,
-                                                   char *header,
-                                                   size_t header_size,
-                                                   char *payload,
-                                                   size_t payload_size)
-{
-    int wrote = 0;
-
-    if (dst == NULL || header == NULL || payload == NULL)
-    {
-        DEBUG_ERROR("NULL parameter");
-        g_errno = ERROR_NULL_PARAMETER;
-        return 0;
-    }
-
-    memset(dst, 0, dst_size);
-
-    if ((header_size + payload_size) >= dst_size)
-    {
-        DEBUG_ERROR("Destination buffer is smaller than required");
-        g_errno = ERROR_BUFFER_SIZE;
-        return 0;
-    }
-
-    wrote = snprintf(dst, dst_size, "%s%s\n", header, payload);
-    if (wrote == 0)
-    {
-        DEBUG_ERROR("Could not format string");
-        g_errno = ERROR_STRING_FORMAT;
-        return false;
-    }
-
-    return (size_t) wrote;
-}
-